@@ -0,0 +1,221 @@
+
+#include "BatchStats.h"
+#include <algorithm>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+// heap order that keeps the smallest key (and for ties the largest index) on top
+bool heap_less(const TopK::Entry& lhs, const TopK::Entry& rhs) {
+    if (lhs.key != rhs.key) return lhs.key > rhs.key;
+    return lhs.index < rhs.index;
+}
+
+//===============================================================================
+template<typename T>
+void read_field(std::istream& in, const char* name, T& value) {
+    std::string label;
+    if (!(in >> label) || label != name || !(in >> value)) {
+        throw std::runtime_error(std::string("Bad batch stats field ") + name);
+    }
+}
+
+//===============================================================================
+void save_top(std::ostream& out, const char* name, const TopK& top) {
+    const auto entries = top.sorted();
+    out << name << ' ' << entries.size();
+    for (const auto& e : entries) out << ' ' << e.key << ' ' << e.index;
+    out << '\n';
+}
+
+//===============================================================================
+void load_top(std::istream& in, const char* name, TopK& top) {
+    std::size_t n = 0;
+    read_field(in, name, n);
+    for (std::size_t i = 0; i < n; ++i) {
+        TopK::Entry e{};
+        if (!(in >> e.key >> e.index)) throw std::runtime_error(std::string("Bad batch stats field ") + name);
+        top.offer(e.key, e.index);
+    }
+}
+
+}
+
+//===============================================================================
+void TopK::offer(double key, int index) {
+    if (k_ == 0) return;
+
+    const Entry e{ key, index };
+    if (heap_.size() < k_) {
+        heap_.push_back(e);
+        std::push_heap(heap_.begin(), heap_.end(), heap_less);
+        return;
+    }
+
+    /* Full: only replace the current smallest if the new entry beats it */
+    if (!heap_less(e, heap_.front())) return;
+    std::pop_heap(heap_.begin(), heap_.end(), heap_less);
+    heap_.back() = e;
+    std::push_heap(heap_.begin(), heap_.end(), heap_less);
+}
+
+//===============================================================================
+void TopK::merge(const TopK& other) {
+    for (const Entry& e : other.heap_) offer(e.key, e.index);
+}
+
+//===============================================================================
+void TopK::shift(int offset) {
+    for (Entry& e : heap_) e.index += offset;
+}
+
+//===============================================================================
+std::vector<TopK::Entry> TopK::sorted() const {
+    std::vector<Entry> out = heap_;
+    std::sort(out.begin(), out.end(), heap_less);
+    return out;
+}
+
+//===============================================================================
+BatchStats::BatchStats(std::size_t top_k) : by_guesses(top_k), by_time(top_k) {}
+
+//===============================================================================
+void BatchStats::add(int index, const sudoku::Result& result) {
+    const sudoku::Stats& st = result.stats;
+    ++count;
+
+    if (result.status == sudoku::Status::Solved) {
+        ++solved;
+        total_time += st.elapsed_ms;
+        total_guesses += st.guesses;
+
+        if (st.guesses == 0) ++no_guess_solves;
+        max_guesses = std::max(max_guesses, st.guesses);
+
+        min_time = std::min(min_time, st.elapsed_ms);
+        max_time = std::max(max_time, st.elapsed_ms);
+    }
+    else {
+        failures.push_back({ index, result.status });
+    }
+
+    if (st.cache_hit) ++cache_hits;
+    total_undo_bytes += double(st.undo_bytes);
+    for (unsigned r = 0; r < sudoku::num_rules; ++r) {
+        totals.rule_calls[r] += st.rule_calls[r];
+        totals.rule_applies[r] += st.rule_applies[r];
+    }
+
+    by_guesses.offer(st.guesses, index);
+    by_time.offer(st.elapsed_ms, index);
+}
+
+//===============================================================================
+void BatchStats::merge(const BatchStats& other) {
+    count += other.count;
+    solved += other.solved;
+    no_guess_solves += other.no_guess_solves;
+    max_guesses = std::max(max_guesses, other.max_guesses);
+    cache_hits += other.cache_hits;
+    total_time += other.total_time;
+    total_guesses += other.total_guesses;
+    total_undo_bytes += other.total_undo_bytes;
+    min_time = std::min(min_time, other.min_time);
+    max_time = std::max(max_time, other.max_time);
+
+    for (unsigned r = 0; r < sudoku::num_rules; ++r) {
+        totals.rule_calls[r] += other.totals.rule_calls[r];
+        totals.rule_applies[r] += other.totals.rule_applies[r];
+    }
+
+    by_guesses.merge(other.by_guesses);
+    by_time.merge(other.by_time);
+
+    /* Each worker's failures are already ascending, so a merge keeps the order */
+    const auto mid = failures.insert(failures.end(), other.failures.begin(), other.failures.end());
+    std::inplace_merge(failures.begin(), mid, failures.end(),
+        [](const Failure& lhs, const Failure& rhs) { return lhs.index < rhs.index; });
+}
+
+//===============================================================================
+void BatchStats::shift_indices(int offset) {
+    by_guesses.shift(offset);
+    by_time.shift(offset);
+    for (Failure& f : failures) f.index += offset;
+}
+
+//===============================================================================
+void BatchStats::save(std::ostream& out) const {
+    // enough digits that the doubles read back exactly
+    const auto precision = out.precision(std::numeric_limits<double>::max_digits10);
+
+    out << "top_k " << by_guesses.capacity() << '\n'
+        << "count " << count << '\n'
+        << "solved " << solved << '\n'
+        << "no_guess_solves " << no_guess_solves << '\n'
+        << "max_guesses " << max_guesses << '\n'
+        << "cache_hits " << cache_hits << '\n'
+        << "total_time " << total_time << '\n'
+        << "total_guesses " << total_guesses << '\n'
+        << "total_undo_bytes " << total_undo_bytes << '\n'
+        << "min_time " << min_time << '\n'
+        << "max_time " << max_time << '\n';
+
+    out << "rules " << sudoku::num_rules;
+    for (unsigned r = 0; r < sudoku::num_rules; ++r) {
+        out << ' ' << totals.rule_calls[r] << ' ' << totals.rule_applies[r];
+    }
+    out << '\n';
+
+    save_top(out, "by_guesses", by_guesses);
+    save_top(out, "by_time", by_time);
+
+    out << "failures " << failures.size();
+    for (const auto& f : failures) out << ' ' << f.index << ' ' << static_cast<int>(f.status);
+    out << '\n';
+
+    out.precision(precision);
+}
+
+//===============================================================================
+BatchStats BatchStats::load(std::istream& in) {
+    std::size_t top_k = 0;
+    read_field(in, "top_k", top_k);
+
+    BatchStats s(top_k);
+    read_field(in, "count", s.count);
+    read_field(in, "solved", s.solved);
+    read_field(in, "no_guess_solves", s.no_guess_solves);
+    read_field(in, "max_guesses", s.max_guesses);
+    read_field(in, "cache_hits", s.cache_hits);
+    read_field(in, "total_time", s.total_time);
+    read_field(in, "total_guesses", s.total_guesses);
+    read_field(in, "total_undo_bytes", s.total_undo_bytes);
+    read_field(in, "min_time", s.min_time);
+    read_field(in, "max_time", s.max_time);
+
+    unsigned rules = 0;
+    read_field(in, "rules", rules);
+    if (rules != sudoku::num_rules) throw std::runtime_error("Bad batch stats field rules");
+    for (unsigned r = 0; r < sudoku::num_rules; ++r) {
+        if (!(in >> s.totals.rule_calls[r] >> s.totals.rule_applies[r])) {
+            throw std::runtime_error("Bad batch stats field rules");
+        }
+    }
+
+    load_top(in, "by_guesses", s.by_guesses);
+    load_top(in, "by_time", s.by_time);
+
+    std::size_t n = 0;
+    read_field(in, "failures", n);
+    for (std::size_t i = 0; i < n; ++i) {
+        int index = 0, status = 0;
+        if (!(in >> index >> status)) throw std::runtime_error("Bad batch stats field failures");
+        s.failures.push_back({ index, static_cast<sudoku::Status>(status) });
+    }
+    return s;
+}
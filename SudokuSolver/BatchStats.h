@@ -0,0 +1,78 @@
+#pragma once
+
+#include "sudoku.h"
+#include <cstddef>
+#include <iosfwd>
+#include <vector>
+
+/*
+The K largest keys seen, kept as a min-heap of at most K entries so each
+offer() is O(log K). Ties keep the smaller index.
+*/
+class TopK {
+public:
+    struct Entry {
+        double key;
+        int index;
+    };
+
+    explicit TopK(std::size_t k) : k_(k) {}
+
+    void offer(double key, int index);
+    void merge(const TopK& other);
+
+    // Largest key first
+    std::vector<Entry> sorted() const;
+    std::size_t capacity() const { return k_; }
+
+    // Add offset to every index, e.g. to move a shard's entries into the whole batch
+    void shift(int offset);
+
+private:
+    std::size_t k_;
+    std::vector<Entry> heap_;
+};
+
+/*
+Summary statistics for a batch run.
+
+Each worker fills its own BatchStats while it solves, so nothing is shared
+or locked on the solve path; the per-thread copies are merged once the
+workers are done. The hardest puzzles by guesses and by time are tracked
+in bounded heaps rather than by sorting every result afterwards.
+
+save() and load() round-trip every field as text, so a checkpointed batch
+can carry its partial totals over to the run that resumes it.
+*/
+class BatchStats {
+public:
+    struct Failure {
+        int index;
+        sudoku::Status status;
+    };
+
+    explicit BatchStats(std::size_t top_k = 10);
+
+    void add(int index, const sudoku::Result& result);
+    void merge(const BatchStats& other);
+    void shift_indices(int offset);
+
+    void save(std::ostream& out) const;
+    // Throws std::runtime_error on malformed input
+    static BatchStats load(std::istream& in);
+
+    unsigned count = 0;
+    unsigned solved = 0;
+    unsigned no_guess_solves = 0;
+    unsigned max_guesses = 0;
+    unsigned cache_hits = 0;
+    double total_time = 0.0;    // over solved puzzles
+    double total_guesses = 0.0; // over solved puzzles
+    double total_undo_bytes = 0.0;
+    double min_time = 1e12;
+    double max_time = 0.0;
+    sudoku::Stats totals;       // summed rule counters
+    TopK by_guesses;
+    TopK by_time;
+    std::vector<Failure> failures; // puzzles that were not solved, by ascending index
+};
@@ -0,0 +1,200 @@
+
+#include "Canonical.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+// Give up on grids whose search keeps more than this many tied candidates
+constexpr std::size_t max_candidates = 1 << 18;
+
+//===============================================================================
+std::vector<std::array<std::uint8_t, 9>> make_column_orders() {
+    // all 6 stack orders times 6 column orders within each of the 3 stacks
+    std::vector<std::array<std::uint8_t, 9>> orders;
+    orders.reserve(1296);
+
+    std::array<std::uint8_t, 3> p3[6] = { {0,1,2}, {0,2,1}, {1,0,2}, {1,2,0}, {2,0,1}, {2,1,0} };
+
+    for (auto& stacks : p3) {
+        for (auto& a : p3) {
+            for (auto& b : p3) {
+                for (auto& c : p3) {
+                    const std::array<std::uint8_t, 3>* within[3] = { &a, &b, &c };
+                    std::array<std::uint8_t, 9> o{};
+                    for (unsigned s = 0; s < 3; ++s) {
+                        for (unsigned k = 0; k < 3; ++k) {
+                            o[3 * s + k] = std::uint8_t(3 * stacks[s] + (*within[s])[k]);
+                        }
+                    }
+                    orders.push_back(o);
+                }
+            }
+        }
+    }
+    return orders;
+}
+
+const std::vector<std::array<std::uint8_t, 9>>& column_orders() {
+    static const auto orders = make_column_orders();
+    return orders;
+}
+
+struct Candidate {
+    std::array<std::uint8_t, 9> rows;
+    std::array<std::uint8_t, 10> relabel;
+    std::uint16_t col_order;
+    std::uint8_t transpose;
+    std::uint8_t next_label;
+};
+
+//===============================================================================
+void render_row(const std::uint8_t* src, const std::array<std::uint8_t, 9>& cols,
+    Candidate& c, std::array<std::uint8_t, 9>& out) {
+    // relabel digits in order of first appearance, extending the candidate's map
+    for (unsigned k = 0; k < 9; ++k) {
+        const std::uint8_t v = src[cols[k]];
+        if (v != 0 && c.relabel[v] == 0) c.relabel[v] = c.next_label++;
+        out[k] = c.relabel[v];
+    }
+}
+
+} // namespace
+
+//===============================================================================
+bool canonicalize(const std::string& puzzle, CanonicalForm& form) {
+    if (puzzle.size() != 81) return false;
+
+    // digits for both orientations
+    std::uint8_t grid[2][81];
+    for (unsigned i = 0; i < 81; ++i) {
+        const char ch = puzzle[i];
+        const std::uint8_t v = (ch >= '1' && ch <= '9') ? std::uint8_t(ch - '0') : 0;
+        grid[0][i] = v;
+        grid[1][9 * (i % 9) + i / 9] = v;
+    }
+
+    const auto& orders = column_orders();
+    std::vector<Candidate> frontier;
+    std::vector<Candidate> next;
+    std::array<std::uint8_t, 9> best{};
+    std::array<std::uint8_t, 9> row{};
+
+    /* Only rows and columns with the fewest clues may supply the first row.
+       Clue counts don't change under the symmetries, so this keeps the form
+       canonical while cutting the search; it is why the result is not the
+       smallest string over every transformation */
+    unsigned clues[2][9] = {};
+    unsigned fewest = 9;
+    for (unsigned t = 0; t < 2; ++t) {
+        for (unsigned i = 0; i < 81; ++i) clues[t][i / 9] += grid[t][i] != 0;
+        for (unsigned r = 0; r < 9; ++r) fewest = std::min(fewest, clues[t][r]);
+    }
+
+    // first row: any orientation, any source row, any column order
+    best.fill(255);
+    for (std::uint8_t t = 0; t < 2; ++t) {
+        for (std::uint8_t r = 0; r < 9; ++r) {
+            if (clues[t][r] != fewest) continue;
+            for (std::uint16_t o = 0; o < orders.size(); ++o) {
+                Candidate c{};
+                c.transpose = t;
+                c.col_order = o;
+                c.next_label = 1;
+                c.rows[0] = r;
+                render_row(&grid[t][9 * r], orders[o], c, row);
+
+                if (row < best) {
+                    best = row;
+                    frontier.clear();
+                }
+                if (row == best) frontier.push_back(c);
+            }
+        }
+    }
+
+    // remaining rows: finish the current band, then start any unused band
+    for (unsigned k = 1; k < 9; ++k) {
+        best.fill(255);
+        next.clear();
+
+        for (const Candidate& base : frontier) {
+            bool used[9] = {};
+            for (unsigned j = 0; j < k; ++j) used[base.rows[j]] = true;
+
+            const unsigned band = base.rows[k - 1] / 3;
+            for (std::uint8_t r = 0; r < 9; ++r) {
+                if (used[r]) continue;
+                if (k % 3 != 0 && r / 3 != band) continue;
+                if (k % 3 == 0 && used[3 * (r / 3)] + used[3 * (r / 3) + 1] + used[3 * (r / 3) + 2] > 0) continue;
+
+                Candidate c = base;
+                c.rows[k] = r;
+                render_row(&grid[c.transpose][9 * r], orders[c.col_order], c, row);
+
+                if (row < best) {
+                    best = row;
+                    next.clear();
+                }
+                if (row == best) {
+                    next.push_back(c);
+                    if (next.size() > max_candidates) return false;
+                }
+            }
+        }
+        frontier.swap(next);
+    }
+
+    Candidate c = frontier.front();
+
+    // complete the relabeling for digits that never appear so it is a bijection
+    bool label_used[10] = {};
+    for (unsigned v = 1; v <= 9; ++v) label_used[c.relabel[v]] = true;
+    std::uint8_t label = 1;
+    for (unsigned v = 1; v <= 9; ++v) {
+        if (c.relabel[v] != 0) continue;
+        while (label_used[label]) ++label;
+        c.relabel[v] = label;
+        label_used[label] = true;
+    }
+
+    form.transform.transpose = c.transpose != 0;
+    form.transform.rows = c.rows;
+    form.transform.cols = orders[c.col_order];
+    form.transform.relabel = c.relabel;
+    form.grid = to_canonical(puzzle, form.transform);
+    return true;
+}
+
+//===============================================================================
+std::string to_canonical(const std::string& grid, const Transform& t) {
+    std::string out(81, '.');
+    for (unsigned r = 0; r < 9; ++r) {
+        for (unsigned c = 0; c < 9; ++c) {
+            const unsigned sr = t.rows[r];
+            const unsigned sc = t.cols[c];
+            const char ch = t.transpose ? grid[9 * sc + sr] : grid[9 * sr + sc];
+            if (ch >= '1' && ch <= '9') out[9 * r + c] = char('0' + t.relabel[ch - '0']);
+        }
+    }
+    return out;
+}
+
+//===============================================================================
+std::string from_canonical(const std::string& grid, const Transform& t) {
+    std::array<char, 10> unlabel{};
+    for (unsigned v = 1; v <= 9; ++v) unlabel[t.relabel[v]] = char('0' + v);
+
+    std::string out(81, '.');
+    for (unsigned r = 0; r < 9; ++r) {
+        for (unsigned c = 0; c < 9; ++c) {
+            const unsigned sr = t.rows[r];
+            const unsigned sc = t.cols[c];
+            const char ch = grid[9 * r + c];
+            if (ch >= '1' && ch <= '9') {
+                (t.transpose ? out[9 * sc + sr] : out[9 * sr + sc]) = unlabel[ch - '0'];
+            }
+        }
+    }
+    return out;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+/*
+Canonical form of a 9x9 puzzle under the validity-preserving symmetries:
+relabeling the digits, permuting rows within a band, permuting the bands,
+the same for columns and stacks, and transposition.
+
+The canonical grid is one representative of the puzzle's class, chosen by
+an ordering that depends only on the class: the first row comes from one
+of the rows or columns with the fewest clues, and from there each row is
+the lexicographically smallest (empty cells count as 0, digits renumbered
+1, 2, ... in order of first appearance) that the transformations allow.
+That is not always the smallest string over all transformations, since a
+row with more clues can sometimes start with more zeros, but equivalent
+puzzles always get the same grid, so two puzzles are equivalent exactly
+when their canonical grids match. The search goes row by row and only
+keeps the candidates that tie for the smallest prefix, which is fast for
+real puzzles.
+Grids with so much symmetry that the search would blow up are rejected
+rather than canonicalized.
+*/
+
+struct Transform {
+    bool transpose = false;
+    std::array<std::uint8_t, 9> rows{};     // canonical row r comes from source row rows[r]
+    std::array<std::uint8_t, 9> cols{};     // canonical column c comes from source column cols[c]
+    std::array<std::uint8_t, 10> relabel{}; // source digit -> canonical digit, 0 stays 0
+};
+
+struct CanonicalForm {
+    std::string grid;    // 81 characters, '.' for empty
+    Transform transform; // maps the input onto grid
+};
+
+// False for grids that are not 81 characters or are too symmetric to search
+bool canonicalize(const std::string& puzzle, CanonicalForm& form);
+
+// Apply a transform to any grid in the input's frame (e.g. a solution), and undo it
+std::string to_canonical(const std::string& grid, const Transform& t);
+std::string from_canonical(const std::string& grid, const Transform& t);
@@ -0,0 +1,91 @@
+#include "Checkpoint.h"
+#include "ResultWriter.h"
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+const char* const checkpoint_magic = "sudoku-checkpoint";
+constexpr unsigned checkpoint_version = 1;
+
+//===============================================================================
+void read_value(std::istream& in, const char* name, std::uint64_t& value) {
+    std::string label;
+    if (!(in >> label) || label != name || !(in >> value)) {
+        throw std::runtime_error(std::string("Bad checkpoint field ") + name);
+    }
+}
+
+}
+
+//===============================================================================
+std::uint64_t batch_fingerprint(const PuzzleArchive& puzzles) {
+    // FNV-1a over the puzzles, with a separator so the line breaks count too
+    std::uint64_t h = 14695981039346656037ull;
+    auto mix = [&](unsigned char c) {
+        h ^= c;
+        h *= 1099511628211ull;
+    };
+    for (std::size_t i = 0; i < puzzles.size(); ++i) {
+        for (char c : puzzles[i]) mix(static_cast<unsigned char>(c));
+        mix('\n');
+    }
+    return h;
+}
+
+//===============================================================================
+void save_checkpoint(const std::string& path, const Checkpoint& cp) {
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            throw std::runtime_error("Could not write checkpoint " + tmp);
+        }
+
+        out << checkpoint_magic << ' ' << checkpoint_version << '\n'
+            << "num_puzzles " << cp.num_puzzles << '\n'
+            << "fingerprint " << cp.fingerprint << '\n'
+            << "next_index " << cp.next_index << '\n'
+            << "output_bytes " << cp.output_bytes << '\n';
+        cp.stats.save(out);
+
+        out.flush();
+        if (!out) {
+            throw std::runtime_error("Could not write checkpoint " + tmp);
+        }
+    }
+    // on disk before the rename, or a power cut could leave an empty checkpoint in place of the old one
+    if (!ResultWriter::sync_file(tmp)) {
+        throw std::runtime_error("Could not sync checkpoint " + tmp);
+    }
+    std::filesystem::rename(tmp, path);
+}
+
+//===============================================================================
+bool load_checkpoint(const std::string& path, Checkpoint& cp) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) return false;
+
+    std::string magic;
+    unsigned version = 0;
+    if (!(in >> magic >> version) || magic != checkpoint_magic) {
+        throw std::runtime_error("Not a checkpoint file: " + path);
+    }
+    if (version != checkpoint_version) {
+        throw std::runtime_error("Checkpoint " + path + " has format version " + std::to_string(version)
+            + ", this build reads version " + std::to_string(checkpoint_version));
+    }
+
+    read_value(in, "num_puzzles", cp.num_puzzles);
+    read_value(in, "fingerprint", cp.fingerprint);
+    read_value(in, "next_index", cp.next_index);
+    read_value(in, "output_bytes", cp.output_bytes);
+    cp.stats = BatchStats::load(in);
+
+    if (cp.next_index > cp.num_puzzles) {
+        throw std::runtime_error("Bad checkpoint field next_index");
+    }
+    return true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "BatchStats.h"
+#include "PuzzleArchive.h"
+#include <cstdint>
+#include <string>
+
+/*
+Progress of a long batch run, saved every so often so a run that crashes
+or is killed can pick up where it left off instead of starting over.
+
+Batches are solved in chunks; after each chunk the results file is fsync'd
+and a checkpoint records how many puzzles are done, how long the results
+file was at that point and the statistics so far. A resumed run cuts the
+results file back to that length, loads the statistics and carries on
+from the next puzzle, so puzzles in the unfinished chunk are solved again
+and nothing is counted twice.
+*/
+struct Checkpoint {
+    std::uint64_t num_puzzles = 0;  // size of the batch
+    std::uint64_t fingerprint = 0;  // batch_fingerprint() of its puzzles
+    std::uint64_t next_index = 0;   // every puzzle before this one is done
+    std::uint64_t output_bytes = 0; // results file size after those puzzles, 0 without one
+    BatchStats stats;
+};
+
+// Hash of the puzzles and their order, to refuse a resume on different inputs
+std::uint64_t batch_fingerprint(const PuzzleArchive& puzzles);
+
+/* Writes path + ".tmp", fsyncs it and renames it over path, so a crash or
+   power cut mid-write keeps the old checkpoint */
+void save_checkpoint(const std::string& path, const Checkpoint& cp);
+
+// False if there is no checkpoint at path; throws std::runtime_error if it is malformed
+bool load_checkpoint(const std::string& path, Checkpoint& cp);
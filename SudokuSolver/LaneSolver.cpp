@@ -0,0 +1,198 @@
+
+#include "LaneSolver.h"
+#include "Puzzle.h"
+#include "Trace.h"
+#include "bit_ops.h"
+#include <chrono>
+#include <cstdint>
+
+namespace {
+
+constexpr unsigned Lanes = 16;
+constexpr unsigned NumCells = Geometry<3>::cells;
+constexpr std::uint16_t Full = base_mask_v<3>;
+
+constexpr auto sets = make_sets<3>();
+constexpr auto peers = make_peers<3>();
+
+struct LaneGroup {
+    alignas(32) std::uint16_t cells[NumCells][Lanes];
+    alignas(32) std::uint16_t singles[NumCells][Lanes];
+    alignas(32) std::uint16_t dead[Lanes];
+    alignas(32) std::uint16_t changed[Lanes];
+    unsigned passes = 0;
+    std::array<unsigned, Lanes> active_passes{};
+};
+
+//===============================================================================
+inline std::uint16_t single_of(std::uint16_t v) {
+    // v itself if it has exactly one bit set, else 0
+    return (v & (v - 1)) == 0 ? v : 0;
+}
+
+//===============================================================================
+void eliminate_singles(LaneGroup& g) {
+    /*
+    Naked singles: every placed value is removed from the peers of its
+    cell. A cell whose own value is also placed in a peer drops to zero,
+    which marks the lane as dead in check_lanes()
+    */
+    for (unsigned c = 0; c < NumCells; ++c) {
+        for (unsigned l = 0; l < Lanes; ++l) g.singles[c][l] = single_of(g.cells[c][l]);
+    }
+
+    for (unsigned c = 0; c < NumCells; ++c) {
+        std::uint16_t seen[Lanes] = {};
+        for (unsigned p : peers[c]) {
+            for (unsigned l = 0; l < Lanes; ++l) seen[l] |= g.singles[p][l];
+        }
+        for (unsigned l = 0; l < Lanes; ++l) {
+            const std::uint16_t v = g.cells[c][l];
+            const std::uint16_t nv = v & ~seen[l];
+            g.changed[l] |= v ^ nv;
+            g.cells[c][l] = nv;
+        }
+    }
+}
+
+//===============================================================================
+void place_hidden_singles(LaneGroup& g) {
+    /*
+    Hidden singles: a value with only one possible cell in a unit goes
+    there. A unit that has lost every cell for some value is a dead lane
+    */
+    for (auto&& set : sets) {
+        std::uint16_t once[Lanes] = {};
+        std::uint16_t more[Lanes] = {};
+        for (unsigned c : set) {
+            for (unsigned l = 0; l < Lanes; ++l) {
+                more[l] |= once[l] & g.cells[c][l];
+                once[l] |= g.cells[c][l];
+            }
+        }
+
+        std::uint16_t hidden[Lanes];
+        for (unsigned l = 0; l < Lanes; ++l) {
+            g.dead[l] |= once[l] != Full;
+            hidden[l] = once[l] & ~more[l];
+        }
+
+        for (unsigned c : set) {
+            for (unsigned l = 0; l < Lanes; ++l) {
+                const std::uint16_t v = g.cells[c][l];
+                const std::uint16_t m = v & hidden[l];
+                const std::uint16_t nv = m ? m : v;
+                g.changed[l] |= v ^ nv;
+                g.cells[c][l] = nv;
+            }
+        }
+    }
+}
+
+//===============================================================================
+void check_lanes(LaneGroup& g, std::uint16_t (&unsolved)[Lanes]) {
+    for (unsigned l = 0; l < Lanes; ++l) unsolved[l] = 0;
+    for (unsigned c = 0; c < NumCells; ++c) {
+        for (unsigned l = 0; l < Lanes; ++l) {
+            const std::uint16_t v = g.cells[c][l];
+            g.dead[l] |= v == 0;
+            unsolved[l] |= single_of(v) == 0;
+        }
+    }
+}
+
+//===============================================================================
+void solve_group(const std::vector<std::string>& grids, const std::vector<std::size_t>& ids,
+    std::size_t first, std::size_t count, std::vector<sudoku::Result>& results, const sudoku::Options& options) {
+    auto start = std::chrono::steady_clock::now();
+
+    LaneGroup g;
+    for (unsigned l = 0; l < Lanes; ++l) {
+        for (unsigned c = 0; c < NumCells; ++c) {
+            /* Unused lanes get an empty board, which propagation leaves alone */
+            const unsigned v = l < count ? symbol_value<3>(grids[ids[first + l]][c]) : 0;
+            g.cells[c][l] = (v > 0 && v <= 9) ? std::uint16_t(1u << (v - 1)) : Full;
+        }
+        g.dead[l] = 0;
+    }
+
+    /* Run every lane until none of them changes any more */
+    std::uint16_t unsolved[Lanes];
+    for (;;) {
+        for (unsigned l = 0; l < Lanes; ++l) g.changed[l] = 0;
+        eliminate_singles(g);
+        place_hidden_singles(g);
+        ++g.passes;
+
+        std::uint16_t any = 0;
+        for (unsigned l = 0; l < Lanes; ++l) {
+            const bool active = g.changed[l] && !g.dead[l];
+            g.active_passes[l] += active;
+            any |= active;
+        }
+        if (!any) break;
+    }
+    check_lanes(g, unsolved);
+
+    auto end = std::chrono::steady_clock::now();
+    const double share_ms = 1e-3 * std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / count;
+
+    for (unsigned l = 0; l < count; ++l) {
+        const std::string& grid = grids[ids[first + l]];
+        sudoku::Result& r = results[ids[first + l]];
+
+        if (!g.dead[l] && unsolved[l]) {
+            // needs guessing: carry on from the propagated state in the scalar solver
+            Puzzle::Entries state;
+            for (unsigned c = 0; c < NumCells; ++c) state[c] = g.cells[c][l];
+
+            Puzzle p(grid, state, options.memory);
+            p.set_time_limit(options.timeout_ms);
+            p.set_undo_mode(options.undo);
+            p.set_branching(options.branching);
+            p.set_rules(options.rules);
+            p.solve();
+            r = p.result();
+        }
+        else if (g.dead[l]) {
+            r.status = sudoku::Status::NoSolution;
+        }
+        else {
+            r.status = sudoku::Status::Solved;
+            r.solution.assign(NumCells, '.');
+            for (unsigned c = 0; c < NumCells; ++c) {
+                r.solution[c] = value_symbols[lowest_bit<3>(g.cells[c][l]) - 1];
+            }
+        }
+
+        /* The two lockstep rules are reported as rules 1 and 2 */
+        r.stats.rule_calls[0] += g.passes;
+        r.stats.rule_calls[1] += g.passes;
+        r.stats.rule_applies[0] += g.active_passes[l];
+        r.stats.rule_applies[1] += g.active_passes[l];
+        r.stats.elapsed_ms += share_ms;
+    }
+}
+
+} // namespace
+
+//===============================================================================
+std::vector<sudoku::Result> solve_lanes(const std::vector<std::string>& grids, const sudoku::Options& options) {
+    SUDOKU_TRACE_SCOPE("lanes");
+    std::vector<sudoku::Result> results(grids.size());
+
+    // 9x9 grids go through the lanes, anything else is solved on its own
+    std::vector<std::size_t> ids;
+    sudoku::Options scalar = options;
+    scalar.engine = sudoku::Engine::Rules;
+    for (std::size_t i = 0; i < grids.size(); ++i) {
+        if (grids[i].size() == NumCells) ids.push_back(i);
+        else results[i] = sudoku::solve(grids[i], scalar);
+    }
+
+    for (std::size_t first = 0; first < ids.size(); first += Lanes) {
+        const std::size_t count = std::min<std::size_t>(Lanes, ids.size() - first);
+        solve_group(grids, ids, first, count, results, options);
+    }
+    return results;
+}
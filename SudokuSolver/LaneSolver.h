@@ -0,0 +1,21 @@
+#pragma once
+
+#include "sudoku.h"
+#include <string>
+#include <vector>
+
+/*
+Solves 9x9 puzzles in groups of 16 that run in lockstep.
+
+The candidate masks are stored structure-of-arrays, one 16-lane row per
+cell, so each step of naked-single elimination, hidden-single placement
+and the validity checks is a plain loop over the lanes that the compiler
+turns into SIMD code (build with -DSUDOKU_NATIVE=ON to target the host's
+widest vector unit). Lanes that are still undecided when propagation stops
+continue from their current state in the scalar solver, so the batch pays
+for guessing only in the puzzles that need it.
+
+Grids that are not 81 characters are solved one by one with the rules engine.
+Time is shared out evenly over the lanes of a group, plus any scalar solve.
+*/
+std::vector<sudoku::Result> solve_lanes(const std::vector<std::string>& grids, const sudoku::Options& options = sudoku::Options());
@@ -0,0 +1,226 @@
+
+#include "ParallelSearch.h"
+#include "Puzzle.h"
+#include "bit_ops.h"
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+template<unsigned B>
+struct Task {
+    typename BasicPuzzle<B>::Entries state;
+    unsigned depth;
+};
+
+template<unsigned B>
+class SearchState {
+public:
+    SearchState(const std::string& grid, const sudoku::Options& options, unsigned threads, unsigned split_depth)
+        : grid_(grid), options_(options), split_depth_(split_depth), queues_(threads), stats_(threads) {
+        if (options.timeout_ms > 0.0) {
+            deadline_ = std::chrono::steady_clock::now() + std::chrono::microseconds(static_cast<long long>(1e3 * options.timeout_ms));
+            has_deadline_ = true;
+        }
+    }
+
+    void push(unsigned worker, Task<B> task) {
+        pending_.fetch_add(1);
+        std::lock_guard<std::mutex> lock(queues_[worker].mutex);
+        queues_[worker].tasks.push_back(std::move(task));
+    }
+
+    //===============================================================================
+    void run(unsigned worker) {
+        Task<B> task;
+        while (!cancel_.load(std::memory_order_relaxed)) {
+            if (take(worker, task)) {
+                process(worker, task);
+                pending_.fetch_sub(1);
+            }
+            else if (pending_.load() == 0) {
+                break;
+            }
+            else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    sudoku::Result result() {
+        sudoku::Result r;
+        for (auto& s : stats_) {
+            r.stats.guesses += s.guesses;
+            r.stats.undo_bytes += s.undo_bytes;
+            for (unsigned i = 0; i < sudoku::num_rules; ++i) {
+                r.stats.rule_calls[i] += s.rule_calls[i];
+                r.stats.rule_applies[i] += s.rule_applies[i];
+            }
+        }
+
+        /* A solution wins over everything; otherwise report the worst outcome */
+        if (!solution_.empty()) {
+            r.status = sudoku::Status::Solved;
+            r.solution = solution_;
+        }
+        else {
+            r.status = failure_;
+        }
+        return r;
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task<B>> tasks;
+    };
+
+    //===============================================================================
+    bool take(unsigned worker, Task<B>& task) {
+        /*
+        Own tasks come off the back (depth first), stolen ones off the front,
+        which are the closest to the root and so the largest
+        */
+        {
+            Queue& q = queues_[worker];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (!q.tasks.empty()) {
+                task = std::move(q.tasks.back());
+                q.tasks.pop_back();
+                return true;
+            }
+        }
+
+        for (std::size_t k = 1; k < queues_.size(); ++k) {
+            Queue& q = queues_[(worker + k) % queues_.size()];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (!q.tasks.empty()) {
+                task = std::move(q.tasks.front());
+                q.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    //===============================================================================
+    void process(unsigned worker, const Task<B>& task) {
+        BasicPuzzle<B> p(grid_, task.state);
+        p.set_cancel_flag(&cancel_);
+        p.set_undo_mode(options_.undo);
+        p.set_branching(options_.branching);
+        p.set_rules(options_.rules);
+
+        if (has_deadline_) {
+            const double remaining_ms = 1e-3 * std::chrono::duration_cast<std::chrono::microseconds>(deadline_ - std::chrono::steady_clock::now()).count();
+            if (remaining_ms <= 0.0) {
+                finish(worker, p, sudoku::Status::Timeout);
+                return;
+            }
+            p.set_time_limit(remaining_ms);
+        }
+
+        if (task.depth >= split_depth_) {
+            p.solve();
+            finish(worker, p, p.status());
+            return;
+        }
+
+        const sudoku::Status s = p.propagate();
+        if (s != sudoku::Status::Unsolved) {
+            finish(worker, p, s);
+            return;
+        }
+
+        /* Fork one board per option of the guess cell, pushed so the lowest value is taken first */
+        const int cell = p.guess_cell();
+        const auto options = p.state()[cell];
+        for (unsigned v = BasicPuzzle<B>::N; v >= 1; --v) {
+            if (!has_bit<B>(options, v)) continue;
+            Task<B> child{ p.state(), task.depth + 1 };
+            child.state[cell] = typename BasicPuzzle<B>::Entry(1u << (v - 1));
+            push(worker, std::move(child));
+            ++stats_[worker].guesses;
+        }
+        finish(worker, p, sudoku::Status::Unsolved);
+    }
+
+    //===============================================================================
+    void finish(unsigned worker, const BasicPuzzle<B>& p, sudoku::Status status) {
+        sudoku::Stats& s = stats_[worker];
+        const sudoku::Stats ps = p.stats();
+        s.guesses += ps.guesses;
+        s.undo_bytes += ps.undo_bytes;
+        for (unsigned i = 0; i < sudoku::num_rules; ++i) {
+            s.rule_calls[i] += ps.rule_calls[i];
+            s.rule_applies[i] += ps.rule_applies[i];
+        }
+
+        if (status == sudoku::Status::Solved) {
+            std::lock_guard<std::mutex> lock(result_mutex_);
+            if (solution_.empty()) solution_ = p.solution();
+            cancel_ = true;
+            return;
+        }
+
+        /* A cancelled task also reports Timeout; that only counts when no solution was found */
+        if (status == sudoku::Status::Unsolved || status == sudoku::Status::NoSolution) return;
+
+        std::lock_guard<std::mutex> lock(result_mutex_);
+        if (status == sudoku::Status::Timeout) {
+            failure_ = status;
+            cancel_ = true;
+        }
+        else if (failure_ == sudoku::Status::NoSolution) {
+            failure_ = status;
+        }
+    }
+
+    const std::string& grid_;
+    const sudoku::Options options_;
+    const unsigned split_depth_;
+    std::vector<Queue> queues_;
+    std::vector<sudoku::Stats> stats_;
+    std::atomic<bool> cancel_{ false };
+    std::atomic<int> pending_{ 0 };
+    bool has_deadline_ = false;
+    std::chrono::steady_clock::time_point deadline_;
+
+    std::mutex result_mutex_;
+    std::string solution_;
+    sudoku::Status failure_ = sudoku::Status::NoSolution;
+};
+
+} // namespace
+
+//===============================================================================
+template<unsigned B>
+sudoku::Result solve_parallel(const std::string& grid, const sudoku::Options& options, unsigned threads, unsigned split_depth) {
+    auto start = std::chrono::steady_clock::now();
+    threads = std::max(1u, threads);
+
+    auto search = std::make_unique<SearchState<B>>(grid, options, threads, split_depth);
+    search->push(0, Task<B>{ BasicPuzzle<B>(grid).state(), 0 });
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; ++t) {
+        workers.emplace_back(&SearchState<B>::run, search.get(), t);
+    }
+    search->run(0);
+    for (auto& w : workers) w.join();
+
+    sudoku::Result r = search->result();
+    auto end = std::chrono::steady_clock::now();
+    r.stats.elapsed_ms = 1e-3 * std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    return r;
+}
+
+template sudoku::Result solve_parallel<2>(const std::string&, const sudoku::Options&, unsigned, unsigned);
+template sudoku::Result solve_parallel<3>(const std::string&, const sudoku::Options&, unsigned, unsigned);
+template sudoku::Result solve_parallel<4>(const std::string&, const sudoku::Options&, unsigned, unsigned);
+template sudoku::Result solve_parallel<5>(const std::string&, const sudoku::Options&, unsigned, unsigned);
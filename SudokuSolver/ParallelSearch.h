@@ -0,0 +1,26 @@
+#pragma once
+
+#include "sudoku.h"
+#include <string>
+
+/*
+Solve one puzzle with several threads.
+
+The top levels of the search tree are split into independent board copies:
+a task applies the rules to its board and, while it is shallower than
+split_depth, forks one task per option of the guess cell. Deeper tasks run
+the ordinary sequential solver. Each thread keeps its own deque of tasks
+(newest first) and steals the oldest task of another thread when it runs
+dry, so big subtrees spread out while each thread stays depth-first. The
+first solution found cancels everything still running.
+
+Stats are summed over all tasks, each fork counting as one guess.
+*/
+template<unsigned B>
+sudoku::Result solve_parallel(const std::string& grid, const sudoku::Options& options,
+    unsigned threads, unsigned split_depth = 4);
+
+extern template sudoku::Result solve_parallel<2>(const std::string&, const sudoku::Options&, unsigned, unsigned);
+extern template sudoku::Result solve_parallel<3>(const std::string&, const sudoku::Options&, unsigned, unsigned);
+extern template sudoku::Result solve_parallel<4>(const std::string&, const sudoku::Options&, unsigned, unsigned);
+extern template sudoku::Result solve_parallel<5>(const std::string&, const sudoku::Options&, unsigned, unsigned);
@@ -1,6 +1,8 @@
 
 #include "Puzzle.h"
 #include "bit_ops.h"
+#include "TextFormat.h"
+#include "Trace.h"
 #include <stdexcept>
 #include <bitset>
 #include <sstream>
@@ -8,99 +10,105 @@
 #include <chrono>
 #include <iostream>
 #include <assert.h>
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+std::pmr::memory_resource* resource_or_default(std::pmr::memory_resource* memory) {
+    return memory ? memory : std::pmr::get_default_resource();
+}
+
+}
 
 //===============================================================================
-Puzzle::Puzzle(const std::string& init, bool quiet) : init_(init), quiet_(quiet) {
-    if (init.size() != 81) {
+template<unsigned B>
+BasicPuzzle<B>::BasicPuzzle(const std::string& init, std::pmr::memory_resource* memory)
+    : init_(init), guesses(resource_or_default(memory)), trail_(resource_or_default(memory)), marks_(resource_or_default(memory)) {
+    SUDOKU_TRACE_SCOPE("parse");
+    if (init.size() != NumCells) {
         throw std::runtime_error("Invalid puzzle size");
     }
 
-    for (int i = 0; i < 81; ++i) {
-        std::string c = init.substr(i, 1);
-        unsigned long j = std::atoi(c.c_str());
+    for (unsigned i = 0; i < NumCells; ++i) {
+        const unsigned j = symbol_value<B>(init[i]);
         if (j > 0) {
-            entries[i] = (1 << (j - 1));
+            entries[i] = Entry(1u << (j - 1));
         }
         else {
-            entries[i] = base_mask;
+            entries[i] = base_mask_v<B>;
         }
     }
 }
 
 //===============================================================================
-std::ostream& operator<<(std::ostream& os, const Puzzle& p) {
-    p.print(os);
-    return os;
+template<unsigned B>
+BasicPuzzle<B>::BasicPuzzle(const std::string& init, const Entries& state, std::pmr::memory_resource* memory)
+    : init_(init), entries(state), guesses(resource_or_default(memory)), trail_(resource_or_default(memory)),
+    marks_(resource_or_default(memory)) {
+    if (init.size() != NumCells) {
+        throw std::runtime_error("Invalid puzzle size");
+    }
 }
 
 //===============================================================================
-void Puzzle::print(std::ostream& p) const {
-
-    p << "++=======+=======+=======++=======+=======+=======++=======+=======+=======++\n";
-
-    for (int i = 0; i < 9; ++i) {
-        for (int sr = 0; sr < 3; ++sr) {
-            p << "||";
-            for (int j = 0; j < 9; ++j) {
-                const int idx = 9 * i + j;
-                const Entry e = entries[idx];
-                bool has_val = has_single_value(e);
-                unsigned val = lowest_bit(e);
-
-                for (int sc = 0; sc < 3; ++sc) {
-                    const int opt = 3 * sr + sc + 1;
+template<unsigned B>
+void BasicPuzzle<B>::print(std::ostream& p) const {
+    // render the whole grid into one buffer and hand it over in a single write
+    std::string text(grid_text_max<B>(), '\0');
+    const char* end = format_grid<B>(entries.data(), &text[0]);
+    p.write(text.data(), end - text.data());
+}
 
-                    if (has_val) {
-                        if (sc == 1 && sr == 1) {
-                            p << " " << "\033[91m" << val << "\033[0m";
-                        }
-                        else {
-                            p << "  ";
-                        }
-                    }
-                    else {
-                        if (has_bit(e, opt)) {
-                            p << " " << "\033[90m" << opt << "\033[0m";
-                        }
-                        else {
-                            p << "  ";
-                        }
-                    }
-                }
-                if ((j + 1) % 3 == 0) {
-                    p << " ||";
-                }
-                else {
-                    p << "\033[90m" << " |" << "\033[0m";
-                }
-            }
+//===============================================================================
+template<unsigned B>
+std::string BasicPuzzle<B>::solution() const {
+    // one character per cell, '.' for cells that are not yet determined
+    std::string s(NumCells, '.');
+    format_solution<B>(entries.data(), &s[0]);
+    return s;
+}
 
-            p << "\n";
+//===============================================================================
+template<unsigned B>
+void BasicPuzzle<B>::summarize() const {
+    std::cout << "\nSOLVED PUZZLE:\n" << *this << "\n";
 
-        }
-        if ((i + 1) % 3 == 0) {
-            p << "++=======+=======+=======++=======+=======+=======++=======+=======+=======++\n";
-        }
-        else {
-            p << "++\033[90m-------+-------+-------\033[0m++\033[90m-------+-------+-------\033[0m++\033[90m-------+-------+-------\033[0m++\n";
-        }
+    std::cout << " Time: " << elapsed << " ms\n";
+    std::cout << " Guesses: " << num_guesses_ << "\n";
+    for (int i = 0; i < 5; ++i) {
+        std::cout << " Rule " << i + 1 << " ratio = " << applies_[i] << "/" << calls_[i] << "\n";
     }
+    std::cout.flush();
 }
 
 //===============================================================================
-void Puzzle::summarize() const {
-    std::cout << "\nSOLVED PUZZLE:" << std::endl;
-    std::cout << *this << std::endl;
-
-    std::cout << " Time: " << elapsed << " ms" << std::endl;
-    std::cout << " Guesses: " << num_guesses_ << std::endl;
-    for (int i = 0; i < 5; ++i) {
-        std::cout << " Rule " << i + 1 << " ratio = " << applies_[i] << "/" << calls_[i] << std::endl;
+template<unsigned B>
+sudoku::Stats BasicPuzzle<B>::stats() const {
+    sudoku::Stats s;
+    s.elapsed_ms = elapsed;
+    s.guesses = num_guesses_;
+    s.undo_bytes = undo_bytes_ + trail_.size() * sizeof(TrailEntry);
+    for (unsigned i = 0; i < sudoku::num_rules; ++i) {
+        s.rule_calls[i] = calls_[i];
+        s.rule_applies[i] = applies_[i];
     }
+    return s;
+}
+
+//===============================================================================
+template<unsigned B>
+sudoku::Result BasicPuzzle<B>::result() const {
+    sudoku::Result r;
+    r.status = status_;
+    if (solved()) r.solution = solution();
+    r.stats = stats();
+    return r;
 }
 
 //===============================================================================
-void Puzzle::solve_recurse() {
+template<unsigned B>
+void BasicPuzzle<B>::solve_recurse() {
     /*
     Works, but is quite a bit slower than the rule-based solve
 
@@ -108,30 +116,27 @@ void Puzzle::solve_recurse() {
     with a peak time of about 10 seconds vs 30 ms.
 
     */
+    SUDOKU_TRACE_SCOPE("recurse");
     auto start = std::chrono::steady_clock::now();
-    solved_ = recurse(entries);
+    deadline_ = start + std::chrono::microseconds(static_cast<long long>(1e3 * time_limit_ms_));
+    const bool found = recurse(entries);
     auto end = std::chrono::steady_clock::now();
-    if (solved_) {
-        elapsed = 1e-3 * std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
-        if( !quiet_ ) std::cout << "Solved " << init_ << " in " << elapsed << " ms " << std::endl;
-    }
-    else {
-        if (!quiet_) std::cout << "FAILED TO SOLVE BY RECURSION" << std::endl;
-    }
+    elapsed = 1e-3 * std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    if (timed_out_) status_ = sudoku::Status::Timeout;
+    else status_ = found ? sudoku::Status::Solved : sudoku::Status::NoSolution;
 }
 
 //===============================================================================
-bool Puzzle::recurse(Entries values) {
+template<unsigned B>
+bool BasicPuzzle<B>::recurse(Entries values) {
+
+    if (out_of_time()) return false;
 
     // update eliminations
-    for (int i = 0; i < 81; ++i) {
-        if (has_single_value(values[i])) {
-            for (auto j : entity_sets[i]) {
-                for (auto ei : sets[j]) {
-                    if (ei != i) {
-                        remove_values(values[ei], values[i]);
-                    }
-                }
+    for (unsigned i = 0; i < NumCells; ++i) {
+        if (has_single_value<B>(values[i])) {
+            for (auto ei : peers[i]) {
+                remove_values<B>(values[ei], values[i]);
             }
         }
     }
@@ -140,9 +145,9 @@ bool Puzzle::recurse(Entries values) {
     unsigned min_bits = 100;
     int next = -1;
 
-    for (int i = 0; i < 81; ++i) {
-        if (!has_single_value(values[i])) {
-            const unsigned num_options = count_bits(values[i]);
+    for (unsigned i = 0; i < NumCells; ++i) {
+        if (!has_single_value<B>(values[i])) {
+            const unsigned num_options = count_bits<B>(values[i]);
             if (num_options < min_bits) {
                 min_bits = num_options;
                 next = i;
@@ -158,10 +163,10 @@ bool Puzzle::recurse(Entries values) {
     // Set a guess for that value
     const Entry val = values[next];
 
-    for (int i = 0; i < 9; ++i) {
-        if (!has_bit(val, i + 1)) continue;
+    for (unsigned i = 0; i < N; ++i) {
+        if (!has_bit<B>(val, i + 1)) continue;
 
-        values[next] = (1 << i);
+        values[next] = Entry(1u << i);
 
         if (recurse(values)) {
             return true;
@@ -172,64 +177,131 @@ bool Puzzle::recurse(Entries values) {
 }
 
 //===============================================================================
-void Puzzle::solve() {
-    int tries = 0;
-    auto start = std::chrono::steady_clock::now();
+template<unsigned B>
+void BasicPuzzle<B>::solve() {
+    start_solve();
+    advance(std::numeric_limits<unsigned>::max());
+}
 
-    try {
+//===============================================================================
+template<unsigned B>
+void BasicPuzzle<B>::start_solve() {
+    tries_ = 0;
+    elapsed = 0.0;
+    started_ = true;
+}
 
-        while (!puzzle_complete()) {
-            ++tries;
+//===============================================================================
+template<unsigned B>
+bool BasicPuzzle<B>::advance(unsigned steps) {
+    if (!started_) start_solve();
+    if (finished()) return true;
+
+    switch (rules_) {
+    case sudoku::RuleSet::Singles: advance_with(SinglesPipeline{}, steps); break;
+    case sudoku::RuleSet::Subsets: advance_with(SubsetsPipeline{}, steps); break;
+    case sudoku::RuleSet::Full:    advance_with(FullPipeline{}, steps); break;
+    }
+    return finished();
+}
 
-            if (tries > 1000000) {
-                throw std::runtime_error("Could not solve puzzle within iteration limit");
-            }
+//===============================================================================
+template<unsigned B>
+template<Rule R>
+inline bool BasicPuzzle<B>::apply_rule() {
+    SUDOKU_TRACE_SCOPE(rule_names[static_cast<unsigned>(R)]);
+    if constexpr (R == Rule::NakedSingles) return rule1();
+    else if constexpr (R == Rule::HiddenSingles) return rule2();
+    else if constexpr (R == Rule::NakedSubsets) return rule3();
+    else if constexpr (R == Rule::HiddenSubsets) return rule4();
+    else return rule5();
+}
 
-            if (rule1()) {
-                if (!is_valid()) revert_guess();
-                continue;
-            }
+//===============================================================================
+template<unsigned B>
+template<Rule... Rules>
+void BasicPuzzle<B>::advance_with(RulePipeline<Rules...> pipeline, unsigned steps) {
+    /*
+    Everything the loop needs between slices lives in the puzzle (board,
+    guess stack or trail, step count), so a slice can stop after any pass.
+    The time limit counts only the time spent inside slices
+    */
+    SUDOKU_TRACE_SCOPE("solve");
+    auto start = std::chrono::steady_clock::now();
+    deadline_ = start + std::chrono::microseconds(static_cast<long long>(1e3 * (time_limit_ms_ - elapsed)));
 
-            if (rule2()) {
-                if (!is_valid()) revert_guess();
-                continue;
+    try {
+
+        for (unsigned step = 0; step < steps; ++step) {
+            if (puzzle_complete()) {
+                // revert_guess() flags the puzzle as having no solution when it runs out of guesses
+                if (status_ == sudoku::Status::Unsolved) status_ = sudoku::Status::Solved;
+                break;
             }
 
-            if (rule3()) {
-                if (!is_valid()) revert_guess();
-                continue;
+            ++tries_;
+
+            if (tries_ > 1000000) {
+                status_ = sudoku::Status::IterationLimit;
+                throw std::runtime_error("Could not solve puzzle within iteration limit");
             }
 
-            if (rule4()) {
-                if (!is_valid()) revert_guess();
-                continue;
+            if (out_of_time()) {
+                status_ = sudoku::Status::Timeout;
+                break;
             }
 
-            if (rule5()) {
-                if (!is_valid()) revert_guess();
+            // the first rule that makes progress sends us back to the first rule
+            if (apply_rules(pipeline)) {
+                if (contradiction_ && !revert_guess()) break;
                 continue;
             }
 
             guess();
+            if (contradiction_ && !revert_guess()) break;
         }
-
-        auto end = std::chrono::steady_clock::now();
-        elapsed = 1e-3 * std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
-        solved_ = true;
-        if (!quiet_) std::cout << "Solved " << init_ << " in " << elapsed << " ms with " << num_guesses_ << " guesses" << std::endl;
     }
     catch (std::exception& e) {
+        if (status_ == sudoku::Status::Unsolved) status_ = sudoku::Status::Failed;
+
         std::ostringstream msg;
-        msg << "FATAL ERROR IN SOLVE after step " << tries << " guess " << num_guesses() << std::endl;
+        msg << "FATAL ERROR IN SOLVE after step " << tries_ << " guess " << num_guesses() << std::endl;
         msg << init_ << std::endl;
         msg << e.what() << std::endl;
         msg << *this << std::endl;
-        if (!quiet_) std::cout << msg.str() << std::endl;
+        error_ = msg.str();
     }
+
+    auto end = std::chrono::steady_clock::now();
+    elapsed += 1e-3 * std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+}
+
+//===============================================================================
+template<unsigned B>
+inline void BasicPuzzle<B>::assign(unsigned i, Entry value) {
+    // every change to the board goes through here so the trail sees it
+    if (logging_ && stamp_[i] != stamp_id_) {
+        stamp_[i] = stamp_id_;
+        trail_.push_back(TrailEntry{ decltype(TrailEntry::cell)(i), entries[i] });
+    }
+    entries[i] = value;
 }
 
 //===============================================================================
-bool Puzzle::rule1() {
+template<unsigned B>
+inline bool BasicPuzzle<B>::eliminate(unsigned i, Entry values) {
+    /* Emptying a cell is the most common contradiction, so flag it right here
+       instead of waiting for a scan of the whole board */
+    Entry e = entries[i];
+    if (!remove_values<B>(e, values)) return false;
+    if (e == 0) contradiction_ = true;
+    assign(i, e);
+    return true;
+}
+
+//===============================================================================
+template<unsigned B>
+bool BasicPuzzle<B>::rule1() {
     /*
     If an entry has a given value, that value
     can be eliminated from all other entries in the
@@ -239,16 +311,13 @@ bool Puzzle::rule1() {
     future calls
     */
     bool changed = false;
-    for (int i = 0; i < 81; ++i) {
-        if (!is_locked(entries[i]) && has_single_value(entries[i])) {
-            for (auto j : entity_sets[i]) {
-                for (auto ei : sets[j]) {
-                    if (ei != i) {
-                        changed |= remove_values(entries[ei], entries[i]);
-                    }
-                }
+    for (unsigned i = 0; i < NumCells; ++i) {
+        if (!is_locked<B>(entries[i]) && has_single_value<B>(entries[i])) {
+            for (auto ei : peers[i]) {
+                changed |= eliminate(ei, entries[i]);
             }
-            entries[i] |= lock_mask;
+            assign(i, entries[i] | lock_mask_v<B>);
+            if (contradiction_) break;
         }
     }
 
@@ -258,7 +327,8 @@ bool Puzzle::rule1() {
     return changed;
 }
 //===============================================================================
-bool Puzzle::rule2() {
+template<unsigned B>
+bool BasicPuzzle<B>::rule2() {
     /*
     If a set has only one location where a given number can go, it
     must go there
@@ -267,32 +337,44 @@ bool Puzzle::rule2() {
 
     for (auto&& set : sets) {
 
-        for (int i = 0; i < 9; ++i) match_count[i] = 0;
+        for (unsigned i = 0; i < N; ++i) match_count[i] = 0;
 
         for (auto ei : set) {
-            for (int i = 0; i < 9; ++i) {
-                if (has_bit(entries[ei], i + 1)) {
+            for (unsigned i = 0; i < N; ++i) {
+                if (has_bit<B>(entries[ei], i + 1)) {
                     match_ids[i] = ei;
                     match_count[i] += 1;
                 }
             }
         }
 
-        for (int i = 0; i < 9; ++i) {
-            if (match_count[i] == 1 && !has_single_value(entries[match_ids[i]])) {
-                entries[match_ids[i]] = (1 << i);
+        for (unsigned i = 0; i < N; ++i) {
+            if (match_count[i] == 0) {
+                // nowhere left for this value in the set
+                contradiction_ = true;
+            }
+            else if (match_count[i] == 1 && !has_single_value<B>(entries[match_ids[i]])) {
+                const Entry value = Entry(1u << i);
+                assign(match_ids[i], value);
                 changed = true;
+
+                // placed twice in one pass (via another set), or next to a cell that already has it
+                for (auto ei : peers[match_ids[i]]) {
+                    if ((entries[ei] & base_mask_v<B>) == value) contradiction_ = true;
+                }
             }
         }
+        if (contradiction_) break;
     }
 
     calls_[1] += 1;
     if (changed) applies_[1] += 1;
 
-    return changed;
+    return changed || contradiction_;
 }
 //===============================================================================
-bool Puzzle::rule3() {
+template<unsigned B>
+bool BasicPuzzle<B>::rule3() {
     /*
     If a set has a group of N entries which each have the same
     N number options (and no others) then those N numbers can
@@ -301,20 +383,22 @@ bool Puzzle::rule3() {
     bool changed = false;
 
     for (auto&& set : sets) {
-        for (int i = 0; i < 9; ++i) {
+        if (contradiction_) break;
+
+        for (unsigned i = 0; i < N; ++i) {
 
             // which other entries in this set have the same values as entry i
             unsigned num_matches = 1; // always matches itself
-            for (int j = i + 1; j < 9; ++j) {
+            for (unsigned j = i + 1; j < N; ++j) {
                 if (entries[set[j]] == entries[set[i]]) {
                     ++num_matches;
                 }
             }
 
-            if (num_matches > 1 && count_bits(entries[set[i]]) == num_matches) {
-                for (int j = 0; j < 9; ++j) {
+            if (num_matches > 1 && count_bits<B>(entries[set[i]]) == num_matches) {
+                for (unsigned j = 0; j < N; ++j) {
                     if (entries[set[j]] != entries[set[i]]) {
-                        changed |= remove_values(entries[set[j]], entries[set[i]]);
+                        changed |= eliminate(set[j], entries[set[i]]);
                     }
                 }
             }
@@ -328,7 +412,8 @@ bool Puzzle::rule3() {
 }
 
 //===============================================================================
-bool Puzzle::rule4() {
+template<unsigned B>
+bool BasicPuzzle<B>::rule4() {
     /*
     If N values within a set are only present in N entries, then
     all other options from those entries can be eliminated
@@ -350,37 +435,39 @@ bool Puzzle::rule4() {
 
 
     for (auto&& set : sets) {
+        if (contradiction_) break;
+
 
         std::fill(columns.begin(), columns.end(), 0);
 
-        for (int i = 0; i < 9; ++i) { // loop rows
+        for (unsigned i = 0; i < N; ++i) { // loop rows
             const Entry e = entries[set[i]];
 
-            for (int j = 0; j < 9; ++j) { // loop bits
-                if (has_bit(e, j + 1)) {
-                    columns[j] |= (1 << i);
+            for (unsigned j = 0; j < N; ++j) { // loop bits
+                if (has_bit<B>(e, j + 1)) {
+                    columns[j] |= Entry(1u << i);
                 }
             }
         }
 
-        for (int i = 0; i < 9; ++i) {
+        for (unsigned i = 0; i < N; ++i) {
             const Entry colI = columns[i];
-            Entry row_mask = (1 << i);
+            Entry row_mask = Entry(1u << i);
 
             unsigned num_matches = 1;
-            for (int j = i + 1; j < 9; ++j) {
+            for (unsigned j = i + 1; j < N; ++j) {
                 const Entry colJ = columns[j];
                 if (colI == colJ) {
                     ++num_matches;
-                    row_mask |= (1 << j);
+                    row_mask |= Entry(1u << j);
                 }
             }
 
-            if (num_matches > 1 && count_bits(colI) == num_matches) {
-                for (int j = 0; j < 9; ++j) {
+            if (num_matches > 1 && count_bits<B>(colI) == num_matches) {
+                for (unsigned j = 0; j < N; ++j) {
                     const Entry ej = entries[set[j]];
-                    if (ej != row_mask && has_bit(colI, j + 1)) {
-                        entries[set[j]] &= row_mask;
+                    if (ej != row_mask && has_bit<B>(colI, j + 1)) {
+                        assign(set[j], entries[set[j]] & row_mask);
                         changed = true;
                     }
                 }
@@ -395,7 +482,8 @@ bool Puzzle::rule4() {
 }
 
 //===============================================================================
-bool Puzzle::rule5() {
+template<unsigned B>
+bool BasicPuzzle<B>::rule5() {
     /*
     If all possible spots for integer i in set J are also
     in set K, then all other instances of i from set K can
@@ -425,61 +513,46 @@ bool Puzzle::rule5() {
     */
     bool changed = false;
 
-    for (int i = 1; i < 10; ++i) {
-        for (int j = 0; j < 27; ++j) { 
+    for (unsigned i = 1; i <= N && !contradiction_; ++i) {
+        for (unsigned j = 0; j < NumSets; ++j) { 
 
             int n = 0;
+            CellMask<B> matches;
 
             // entry ids in sets[j] that contain value i
             for (auto ei : sets[j]) {
-                if (has_bit(entries[ei], i)) {
+                if (has_bit<B>(entries[ei], i)) {
                     match_ids[n++] = ei;
+                    matches.set(ei);
                 }
             }
 
             if (n > 1) {
-                const bool setJIsBox = j >= 18;
+                // find the other set (if any) that contains all the matches
                 int k = -1;
 
-                if (setJIsBox) {
-
-                    // check if all the matches are in the same row or column
-                    const unsigned row = match_ids[0] / 9;
-                    const unsigned col = match_ids[0] % 9;
-
-                    int row_set = row;
-                    int col_set = 9 + col;
-
-                    for (int m = 1; m < n; ++m) {
-                        if (match_ids[m] / 9 != row) row_set = -1;
-                        if (match_ids[m] % 9 != col) col_set = -1;
-                    }
+                if (j >= 2 * N) {
+                    // setJ is a box, check if all the matches are in the same row or column
+                    const unsigned row = cell_row<B>(match_ids[0]);
+                    const unsigned col = N + cell_col<B>(match_ids[0]);
 
-                    k = (row_set >= 0) ? row_set : col_set;
+                    if (unit_masks[row].contains(matches)) k = row;
+                    else if (unit_masks[col].contains(matches)) k = col;
                 }
                 else {
-                    // setJ is a row or column set
-                    // check if all the match_ids are in the same box
-                    const unsigned box = entry_box_id(match_ids[0]);
+                    // setJ is a row or column set, check if all the matches are in the same box
+                    const unsigned box = 2 * N + cell_box<B>(match_ids[0]);
 
-                    int box_set = box + 18;
-
-                    for (int m = 1; m < n; ++m) {
-                        if (entry_box_id(match_ids[m]) != box) box_set = -1;
-                    }
-
-                    k = box_set;
+                    if (unit_masks[box].contains(matches)) k = box;
                 }
 
                 if (k >= 0) {
                     // set k contains all the match ids, remove i from all the non-matched ids in set k
-                    auto* begin = match_ids.data();
-                    auto* end = begin + n;
-                    const Entry iVal = (1 << (i - 1));
+                    const Entry iVal = Entry(1u << (i - 1));
 
                     for (auto ei : sets[k]) {
-                        if (std::find(begin, end, ei) == end) {
-                            changed |= remove_values(entries[ei], iVal);
+                        if (!matches.test(ei)) {
+                            changed |= eliminate(ei, iVal);
                         }
                     }
                 }
@@ -494,87 +567,304 @@ bool Puzzle::rule5() {
 }
 
 //===============================================================================
-void Puzzle::guess() {
+template<unsigned B>
+void BasicPuzzle<B>::guess() {
+    SUDOKU_TRACE_SCOPE("guess");
     /*
-    Pick a cell with the minimum number of choices, save the current state,
-    and make a guess. Eliminate the guessed value from the saved state so
-    if we have to revert, we don't guess the same thing
+    Pick a cell and value with the branching strategy, save the current
+    state, and make a guess. Eliminate the guessed value from the saved
+    state so if we have to revert, we don't guess the same thing
     */
     ++num_guesses_;
 
+    unsigned guess_id = 0;
+    Entry guess_mask = 0;
+    if (!choose_guess(guess_id, guess_mask)) {
+        throw std::runtime_error("Reached invalid state in guessing routine - nothing left to guess");
+    }
+    if (guess_mask == 0) {
+        // nothing to guess in an empty cell: the board is a dead end
+        contradiction_ = true;
+        return;
+    }
+    assert(is_valid());
+
+    if (undo_ == sudoku::Undo::Trail) {
+        // remember where this guess starts in the trail, then log every change after it
+        push_mark(guess_id, guess_mask);
+        assign(guess_id, guess_mask);
+        return;
+    }
+
+    guesses.push_back(entries);
+    remove_values<B>(guesses.back()[guess_id], guess_mask);
+    entries[guess_id] = guess_mask;
+    undo_bytes_ += sizeof(Entries);
+}
+
+//===============================================================================
+template<unsigned B>
+bool BasicPuzzle<B>::choose_guess(unsigned& cell, Entry& value) const {
+    /*
+    Mrv:       the first cell with the fewest options, lowest value first
+    Degree:    of the cells with the fewest options, the one with the most
+               undetermined peers, so the guess constrains the most cells
+    Frequency: the Mrv cell, trying first the value that the fewest peers
+               could still take (the least constraining value)
+    UnitDigit: a value with fewer possible places in some set than the Mrv
+               cell has options, guessed in its first place; Mrv otherwise
+    */
+    const int mrv = guess_cell();
+    if (mrv < 0) return false;
+
+    cell = unsigned(mrv);
+    if ((entries[cell] & base_mask_v<B>) == 0) {
+        // a cell with no options left (a state handed in already broken): value 0 says so
+        value = 0;
+        return true;
+    }
+    value = Entry(1u << (lowest_bit<B>(entries[cell]) - 1));
+    const unsigned min_bits = count_bits<B>(entries[cell]);
+
+    auto open_peers = [this](unsigned i) {
+        unsigned n = 0;
+        for (auto ei : peers[i]) n += !has_single_value<B>(entries[ei]);
+        return n;
+    };
+
+    switch (branching_) {
+    case sudoku::Branching::Mrv:
+        break;
+
+    case sudoku::Branching::Degree: {
+        unsigned best = open_peers(cell);
+        for (unsigned i = cell + 1; i < NumCells; ++i) {
+            if (has_single_value<B>(entries[i]) || count_bits<B>(entries[i]) != min_bits) continue;
+            const unsigned d = open_peers(i);
+            if (d > best) {
+                best = d;
+                cell = i;
+            }
+        }
+        value = Entry(1u << (lowest_bit<B>(entries[cell]) - 1));
+        break;
+    }
+
+    case sudoku::Branching::Frequency: {
+        unsigned best = ~0u;
+        for (unsigned v = 1; v <= N; ++v) {
+            if (!has_bit<B>(entries[cell], v)) continue;
+            unsigned n = 0;
+            for (auto ei : peers[cell]) n += has_bit<B>(entries[ei], v);
+            if (n < best) {
+                best = n;
+                value = Entry(1u << (v - 1));
+            }
+        }
+        break;
+    }
+
+    case sudoku::Branching::UnitDigit: {
+        // no set can offer fewer than two places once rule2 has run
+        if (min_bits <= 2) break;
+
+        unsigned best = min_bits;
+        for (auto&& set : sets) {
+            for (unsigned v = 1; v <= N; ++v) {
+                unsigned n = 0;
+                unsigned first = 0;
+                bool placed = false;
+                for (auto ei : set) {
+                    if (!has_bit<B>(entries[ei], v)) continue;
+                    if (has_single_value<B>(entries[ei])) placed = true;
+                    if (n++ == 0) first = ei;
+                }
+                if (!placed && n > 1 && n < best) {
+                    best = n;
+                    cell = first;
+                    value = Entry(1u << (v - 1));
+                }
+            }
+        }
+        break;
+    }
+    }
+
+    return true;
+}
+
+//===============================================================================
+template<unsigned B>
+int BasicPuzzle<B>::guess_cell() const {
+    // the undetermined cell with the fewest options, -1 when every cell is set
     unsigned min_bits = 100;
     int guess_id = -1;
 
-    for (int i = 0; i < 81; ++i) {
-        if (!has_single_value(entries[i])) {
-            const unsigned num_options = count_bits(entries[i]);
+    for (unsigned i = 0; i < NumCells; ++i) {
+        if (!has_single_value<B>(entries[i])) {
+            const unsigned num_options = count_bits<B>(entries[i]);
             if (num_options < min_bits) {
                 min_bits = num_options;
                 guess_id = i;
             }
         }
     }
+    return guess_id;
+}
 
-    if (guess_id < 0) {
-        throw std::runtime_error("Reached invalid state in guessing routine - nothing left to guess");
+//===============================================================================
+template<unsigned B>
+sudoku::Status BasicPuzzle<B>::propagate() {
+    switch (rules_) {
+    case sudoku::RuleSet::Singles: return propagate_with(SinglesPipeline{});
+    case sudoku::RuleSet::Subsets: return propagate_with(SubsetsPipeline{});
+    case sudoku::RuleSet::Full:    break;
+    }
+    return propagate_with(FullPipeline{});
+}
+
+//===============================================================================
+template<unsigned B>
+template<Rule... Rules>
+sudoku::Status BasicPuzzle<B>::propagate_with(RulePipeline<Rules...> pipeline) {
+    SUDOKU_TRACE_SCOPE("propagate");
+    /*
+    The rule part of solve() without any guessing: stop when the puzzle is
+    complete, contradicts itself, or no rule makes progress
+    */
+    try {
+        while (!puzzle_complete()) {
+            if (out_of_time()) return status_ = sudoku::Status::Timeout;
+
+            if (apply_rules(pipeline)) {
+                if (contradiction_) return status_ = sudoku::Status::NoSolution;
+                continue;
+            }
+            return status_ = sudoku::Status::Unsolved;
+        }
+    }
+    catch (std::exception&) {
+        // a complete but inconsistent unit
+        return status_ = sudoku::Status::NoSolution;
     }
+    return status_ = sudoku::Status::Solved;
+}
 
-    const Entry guessed_entity = entries[guess_id];
-    const unsigned guess_value = lowest_bit(guessed_entity);
-    assert(guess_value < 10);
-    const Entry guess_mask = (1 << (guess_value - 1));
+//===============================================================================
+template<unsigned B>
+void BasicPuzzle<B>::push_mark(unsigned cell, Entry value) {
+    // remember where this guess or edit starts in the trail, then log every change after it
+    marks_.push_back(Mark{ trail_.size(), cell, value, stamp_id_ });
+    stamp_id_ = ++next_stamp_;
+    logging_ = true;
+}
 
-    guesses.push_back(entries);
-    remove_values(guesses.back()[guess_id], guess_mask);
-    entries[guess_id] = guess_mask;
+//===============================================================================
+template<unsigned B>
+typename BasicPuzzle<B>::Mark BasicPuzzle<B>::pop_mark() {
+    // undo the changes logged since the newest mark, newest first
+    const Mark m = marks_.back();
+    marks_.pop_back();
+    for (std::size_t k = trail_.size(); k > m.trail_size; --k) {
+        entries[trail_[k - 1].cell] = trail_[k - 1].old;
+    }
+    undo_bytes_ += 2 * (trail_.size() - m.trail_size) * sizeof(TrailEntry);
+    trail_.resize(m.trail_size);
+
+    /* Cells logged for the parent mark may have been re-stamped since;
+       logging them again is harmless because undo runs newest first */
+    stamp_id_ = m.stamp;
+    logging_ = !marks_.empty();
+    return m;
 }
 
 //===============================================================================
-void Puzzle::revert_guess() {
+template<unsigned B>
+sudoku::Status BasicPuzzle<B>::place(unsigned cell, unsigned value) {
+    /*
+    Make value a given of cell on top of the current (propagated) state and
+    propagate again. A value the cell can no longer take is a contradiction
+    */
+    const Entry mask = Entry(1u << (value - 1));
+    push_mark(cell, mask);
+    contradiction_ = false;
+
+    if (!has_bit<B>(entries[cell], value)) return status_ = sudoku::Status::NoSolution;
+    assign(cell, mask);
+    return propagate();
+}
+
+//===============================================================================
+template<unsigned B>
+bool BasicPuzzle<B>::undo_place() {
+    if (marks_.empty()) return false;
+    pop_mark();
+    contradiction_ = false;
+    status_ = sudoku::Status::Unsolved;
+    return true;
+}
+
+//===============================================================================
+template<unsigned B>
+bool BasicPuzzle<B>::revert_guess() {
+    SUDOKU_TRACE_SCOPE("revert");
     /*
     If a solution cannot be found, revert to the state before the
-    most recent guess
+    most recent guess. Returns false (and marks the puzzle as having
+    no solution) if there are no guesses left to revert.
     */
+    contradiction_ = false;
+
+    if (undo_ == sudoku::Undo::Trail) {
+        if (marks_.empty()) {
+            status_ = sudoku::Status::NoSolution;
+            return false;
+        }
+
+        // rule out the guessed value (logged against the previous guess, if there is one)
+        const Mark m = pop_mark();
+        eliminate(m.cell, m.value);
+        return true;
+    }
+
     if (guesses.empty()) {
-        throw std::runtime_error("Solution failed, no more guesses to revert");
+        status_ = sudoku::Status::NoSolution;
+        return false;
     }
 
     entries = guesses.back();
     guesses.pop_back();
+    undo_bytes_ += sizeof(Entries);
+    return true;
 }
 
 //===============================================================================
-bool Puzzle::set_complete(const std::array<unsigned, 9>& set) const {
+template<unsigned B>
+bool BasicPuzzle<B>::set_complete(const std::array<unsigned, N>& set) const {
     /*
-    Check if a set is complete (has a single value in each entry)
-    throw if it is complete but invalid.
+    Check if a set is complete (has a single value in each entry). A set
+    that is full but has a value twice is not complete: both copies are
+    still unlocked, so the next rule1() pass empties one of them and flags
+    the contradiction.
     */
 
     Entry mask = 0;
 
     for (auto ei : set) {
-        if (!has_single_value(entries[ei])) {
+        if (!has_single_value<B>(entries[ei])) {
             return false;
         }
         else {
-            mask ^= (entries[ei] & base_mask);
+            mask ^= (entries[ei] & base_mask_v<B>);
         }
     }
 
-    if (mask == base_mask) {
-        return true;
-    }
-    else {
-        std::stringstream msg;
-        msg << "Puzzle has entered an invalid state" << std::endl;
-        msg << *this << std::endl;
-        throw std::runtime_error(msg.str());
-    }
-
+    return mask == base_mask_v<B>;
 }
 
 //===============================================================================
-bool Puzzle::puzzle_complete() const {
+template<unsigned B>
+bool BasicPuzzle<B>::puzzle_complete() const {
     // Check if the puzzle is complete (all sets complete)
     for (auto&& set : sets) {
         if (!set_complete(set)) {
@@ -585,7 +875,8 @@ bool Puzzle::puzzle_complete() const {
 }
 
 //===============================================================================
-bool Puzzle::is_valid() const {
+template<unsigned B>
+bool BasicPuzzle<B>::is_valid() const {
     /*
     Check if the puzzle is still in a valid state. Examples of an invalid
     state would be entries with no choices left, or duplicate entries in a set.
@@ -594,7 +885,7 @@ bool Puzzle::is_valid() const {
     // not valid if any Entry has 0 remaining options
     constexpr Entry zero = 0;
     for (auto e : entries) {
-        if ((e & base_mask) == zero) {
+        if ((e & base_mask_v<B>) == zero) {
             return false;
         }
     }
@@ -604,9 +895,9 @@ bool Puzzle::is_valid() const {
         Entry expected = 0;
         bool errs = false;
         for (auto ei : set) {
-            if (has_single_value(entries[ei])) {
-                if ((expected & (entries[ei] & base_mask)) > 0) return false;
-                expected |= (entries[ei] & base_mask);
+            if (has_single_value<B>(entries[ei])) {
+                if ((expected & (entries[ei] & base_mask_v<B>)) > 0) return false;
+                expected |= (entries[ei] & base_mask_v<B>);
             }
         }
     }
@@ -614,4 +905,22 @@ bool Puzzle::is_valid() const {
     return true;
 }
 
-//===============================================================================
\ No newline at end of file
+//===============================================================================
+
+//===============================================================================
+template<unsigned B>
+bool BasicPuzzle<B>::out_of_time() {
+    // only look at the clock every 256 calls, and not at all without a limit
+    if (timed_out_) return true;
+    if (cancel_ && cancel_->load(std::memory_order_relaxed)) return timed_out_ = true;
+    if (time_limit_ms_ <= 0.0 || (++deadline_checks_ & 255) != 0) return false;
+
+    timed_out_ = std::chrono::steady_clock::now() > deadline_;
+    return timed_out_;
+}
+
+//===============================================================================
+template class BasicPuzzle<2>;
+template class BasicPuzzle<3>;
+template class BasicPuzzle<4>;
+template class BasicPuzzle<5>;
@@ -1,131 +1,230 @@
 #pragma once
 
+#include "sudoku.h"
+#include "unit_tables.h"
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory_resource>
+#include <ostream>
 #include <string>
+#include <type_traits>
 #include <vector>
 
-using Entry = unsigned short;
+/*
+Each cell is stored as a bit mask of the values that can still go there
+(bit 0 for value 1, ...) with one extra bit above the values used as a
+lock flag. 4x4 and 9x9 boards fit in 16 bits, 16x16 and 25x25 need 32.
+*/
+template<unsigned B>
+using entry_t = std::conditional_t<(B * B < 16), std::uint16_t, std::uint32_t>;
+
+template<unsigned B>
+constexpr entry_t<B> base_mask_v = entry_t<B>((1u << (B * B)) - 1);
+
+template<unsigned B>
+constexpr entry_t<B> lock_mask_v = entry_t<B>(1u << (B * B));
+
+using Entry = entry_t<3>;
 using Entries = std::array<Entry,81>;
 
-constexpr Entry base_mask = 0b0111111111;
-constexpr Entry lock_mask = 0b1000000000;
+constexpr Entry base_mask = base_mask_v<3>;
+constexpr Entry lock_mask = lock_mask_v<3>;
+
+/*
+Deduction rules, in the order solve() tries them. A RulePipeline lists
+the rules a solver is built with: they are folded into one short-circuit
+expression at compile time, so rules that are not listed are never called
+and the ones that are get inlined into the solve loop.
+*/
+enum class Rule {
+    NakedSingles,  // rule1: a placed value leaves its peers
+    HiddenSingles, // rule2: a value with one place left in a set goes there
+    NakedSubsets,  // rule3: n cells with the same n options
+    HiddenSubsets, // rule4: n values confined to the same n cells
+    Intersections  // rule5: box/line pointing and claiming
+};
+
+// Names for the rules in traces and reports, indexed by Rule
+constexpr const char* rule_names[] = { "rule1", "rule2", "rule3", "rule4", "rule5" };
+
+template<Rule... Rules>
+struct RulePipeline {};
 
-class Puzzle {
+using SinglesPipeline = RulePipeline<Rule::NakedSingles, Rule::HiddenSingles>;
+using SubsetsPipeline = RulePipeline<Rule::NakedSingles, Rule::HiddenSingles, Rule::NakedSubsets, Rule::HiddenSubsets>;
+using FullPipeline = RulePipeline<Rule::NakedSingles, Rule::HiddenSingles, Rule::NakedSubsets, Rule::HiddenSubsets, Rule::Intersections>;
+
+template<unsigned B>
+class BasicPuzzle {
 public:
-    Puzzle(const std::string& init, bool quiet = false);
-    Puzzle(const Puzzle& p) = delete;
-    Puzzle& operator=(const Puzzle& p) = delete;
+    static constexpr unsigned N = Geometry<B>::N;
+    static constexpr unsigned NumCells = Geometry<B>::cells;
+    static constexpr unsigned NumSets = Geometry<B>::units;
+
+    using Entry = entry_t<B>;
+    using Entries = std::array<Entry, NumCells>;
+
+    // The guess stack and trail are allocated from memory, the default resource if null
+    explicit BasicPuzzle(const std::string& init, std::pmr::memory_resource* memory = nullptr);
+    // Resume from a partly solved state of the puzzle init
+    BasicPuzzle(const std::string& init, const Entries& state, std::pmr::memory_resource* memory = nullptr);
+    BasicPuzzle(const BasicPuzzle& p) = delete;
+    BasicPuzzle& operator=(const BasicPuzzle& p) = delete;
 
     void summarize() const;
     void solve();
     void solve_recurse();
 
-    bool solved() const { return solved_; }
+    /*
+    Resumable solve: advance() runs at most steps passes of the solve loop
+    (a rule pass or a guess each) and returns true once the puzzle is
+    finished, keeping the board and the open guesses for the next call.
+    solve() is one advance() without a step limit; start_solve() resets
+    the step count and the time spent. elapsed_time() and the time limit
+    only count time inside advance()
+    */
+    void start_solve();
+    bool advance(unsigned steps);
+    bool finished() const { return status_ != sudoku::Status::Unsolved; }
+
+    // Give up with Status::Timeout once a solve has run this long (0 = no limit)
+    void set_time_limit(double ms) { time_limit_ms_ = ms; }
+
+    // How guesses are taken back; switch before solving
+    void set_undo_mode(sudoku::Undo mode) { undo_ = mode; }
+
+    // Which cell and value guess() picks
+    void set_branching(sudoku::Branching b) { branching_ = b; }
+
+    // Which of the prebuilt rule pipelines solve() and propagate() use
+    void set_rules(sudoku::RuleSet rules) { rules_ = rules; }
+
+    // Stop (reported as Status::Timeout) as soon as *flag becomes true
+    void set_cancel_flag(const std::atomic<bool>* flag) { cancel_ = flag; }
+
+    /*
+    Building blocks for searches driven from outside (see ParallelSearch.h):
+    propagate() applies the rules until none makes progress and returns
+    Solved, NoSolution, Timeout, or Unsolved when a guess is needed;
+    guess_cell() is the undetermined cell with the fewest options, -1 if none.
+    */
+    sudoku::Status propagate();
+    int guess_cell() const;
+
+    /*
+    Edits for incremental sessions (see Session.h): place() makes value
+    (1..N) a given of cell and propagates, logging every change it causes;
+    undo_place() takes back the most recent place() exactly. Don't mix with
+    solve() on the same object
+    */
+    sudoku::Status place(unsigned cell, unsigned value);
+    bool undo_place();
+    const Entries& state() const { return entries; }
+
+    bool solved() const { return status_ == sudoku::Status::Solved; }
+    sudoku::Status status() const { return status_; }
+    const std::string& error_message() const { return error_; }
     double elapsed_time() const { return elapsed; }
     std::string initial_state() const { return init_; }
+    std::string solution() const;
     int num_guesses() const { return num_guesses_; }
+    sudoku::Stats stats() const;
+    sudoku::Result result() const;
 
-    friend std::ostream& operator<<(std::ostream& os, const Puzzle& p);
+    friend std::ostream& operator<<(std::ostream& os, const BasicPuzzle& p) {
+        p.print(os);
+        return os;
+    }
 
 private:
     void print(std::ostream& os) const;
 
     bool recurse(Entries values);
+
+    template<Rule... Rules>
+    void advance_with(RulePipeline<Rules...>, unsigned steps);
+    template<Rule... Rules>
+    sudoku::Status propagate_with(RulePipeline<Rules...>);
+    template<Rule... Rules>
+    bool apply_rules(RulePipeline<Rules...>) { return (apply_rule<Rules>() || ...); }
+    template<Rule R>
+    bool apply_rule();
     bool rule1();
     bool rule2();
     bool rule3();
     bool rule4();
     bool rule5();
     void guess();
-    void revert_guess();
-    bool set_complete(const std::array<unsigned, 9>& set) const;
+    bool choose_guess(unsigned& cell, Entry& value) const;
+    bool revert_guess();
+    void assign(unsigned i, Entry value);
+    bool eliminate(unsigned i, Entry values);
+    bool set_complete(const std::array<unsigned, N>& set) const;
     bool puzzle_complete() const;
     bool is_valid() const;
+    bool out_of_time();
 
-    std::array<Entry, 9> columns{};
-    std::array<unsigned, 9> match_ids{};
-    std::array<unsigned, 9> match_count{};
+    std::array<Entry, N> columns{};
+    std::array<unsigned, N> match_ids{};
+    std::array<unsigned, N> match_count{};
     std::array<unsigned, 6> calls_{};
     std::array<unsigned, 6> applies_{};
 
     std::string init_;
+    std::string error_;
     Entries entries;
-    std::vector<Entries> guesses;
+    std::pmr::vector<Entries> guesses;
+
+    /* Trail undo: (cell, previous mask) for the first change to a cell under
+       each open guess, and where each guess starts in the trail. stamp_ holds
+       the guess a cell was last logged for, so later changes are not logged again */
+    struct TrailEntry {
+        std::conditional_t<(NumCells < 65536), std::uint16_t, unsigned> cell;
+        Entry old;
+    };
+    struct Mark {
+        std::size_t trail_size;
+        unsigned cell;
+        Entry value;
+        unsigned stamp;
+    };
+    void push_mark(unsigned cell, Entry value);
+    Mark pop_mark();
+
+    sudoku::Undo undo_ = sudoku::Undo::Snapshot;
+    sudoku::Branching branching_ = sudoku::Branching::Mrv;
+    sudoku::RuleSet rules_ = sudoku::RuleSet::Full;
+    bool logging_ = false;
+    unsigned stamp_id_ = 0;
+    unsigned next_stamp_ = 0;
+    std::array<unsigned, NumCells> stamp_{};
+    std::pmr::vector<TrailEntry> trail_;
+    std::pmr::vector<Mark> marks_;
+    std::uint64_t undo_bytes_ = 0;
 
     unsigned num_guesses_ = 0;
+    unsigned tries_ = 0;
+    bool started_ = false;
     double elapsed = 0.0;
-    bool solved_ = false;
-    const bool quiet_ = false;
-
-    static constexpr std::array<std::array<unsigned, 3>, 81> entity_sets = { {
-        { 0, 9,18}, { 0,10,18}, { 0,11,18},
-        { 0,12,19}, { 0,13,19}, { 0,14,19},
-        { 0,15,20}, { 0,16,20}, { 0,17,20},
-
-        { 1, 9,18}, { 1,10,18}, { 1,11,18},
-        { 1,12,19}, { 1,13,19}, { 1,14,19},
-        { 1,15,20}, { 1,16,20}, { 1,17,20},
-
-        { 2, 9,18}, { 2,10,18}, { 2,11,18},
-        { 2,12,19}, { 2,13,19}, { 2,14,19},
-        { 2,15,20}, { 2,16,20}, { 2,17,20},
-
-        { 3, 9,21}, { 3,10,21}, { 3,11,21},
-        { 3,12,22}, { 3,13,22}, { 3,14,22},
-        { 3,15,23}, { 3,16,23}, { 3,17,23},
-
-        { 4, 9,21}, { 4,10,21}, { 4,11,21},
-        { 4,12,22}, { 4,13,22}, { 4,14,22},
-        { 4,15,23}, { 4,16,23}, { 4,17,23},
-
-        { 5, 9,21}, { 5,10,21}, { 5,11,21},
-        { 5,12,22}, { 5,13,22}, { 5,14,22},
-        { 5,15,23}, { 5,16,23}, { 5,17,23},
-
-        { 6, 9,24}, { 6,10,24}, { 6,11,24},
-        { 6,12,25}, { 6,13,25}, { 6,14,25},
-        { 6,15,26}, { 6,16,26}, { 6,17,26},
-
-        { 7, 9,24}, { 7,10,24}, { 7,11,24},
-        { 7,12,25}, { 7,13,25}, { 7,14,25},
-        { 7,15,26}, { 7,16,26}, { 7,17,26},
-
-        { 8, 9,24}, { 8,10,24}, { 8,11,24},
-        { 8,12,25}, { 8,13,25}, { 8,14,25},
-        { 8,15,26}, { 8,16,26}, { 8,17,26}
-    } };
-
-    static constexpr std::array<std::array<unsigned, 9>, 27> sets = { {
-        { 0, 1, 2,  3, 4, 5,  6, 7, 8}, // 0
-        { 9,10,11, 12,13,14, 15,16,17},
-        {18,19,20, 21,22,23, 24,25,26},
-        {27,28,29, 30,31,32, 33,34,35},
-        {36,37,38, 39,40,41, 42,43,44},
-        {45,46,47, 48,49,50, 51,52,53},
-        {54,55,56, 57,58,59, 60,61,62},
-        {63,64,65, 66,67,68, 69,70,71},
-        {72,73,74, 75,76,77, 78,79,80},
-
-        { 0, 9,18, 27,36,45, 54,63,72}, // 9
-        { 1,10,19, 28,37,46, 55,64,73},
-        { 2,11,20, 29,38,47, 56,65,74},
-        { 3,12,21, 30,39,48, 57,66,75},
-        { 4,13,22, 31,40,49, 58,67,76},
-        { 5,14,23, 32,41,50, 59,68,77},
-        { 6,15,24, 33,42,51, 60,69,78},
-        { 7,16,25, 34,43,52, 61,70,79},
-        { 8,17,26, 35,44,53, 62,71,80},
-
-        { 0, 1, 2,  9,10,11, 18,19,20}, // 18
-        { 3, 4, 5, 12,13,14, 21,22,23},
-        { 6, 7, 8, 15,16,17, 24,25,26},
-        {27,28,29, 36,37,38, 45,46,47},
-        {30,31,32, 39,40,41, 48,49,50},
-        {33,34,35, 42,43,44, 51,52,53},
-        {54,55,56, 63,64,65, 72,73,74},
-        {57,58,59, 66,67,68, 75,76,77},
-        {60,61,62, 69,70,71, 78,79,80}
-    }};
+    double time_limit_ms_ = 0.0;
+    std::chrono::steady_clock::time_point deadline_;
+    unsigned deadline_checks_ = 0;
+    bool timed_out_ = false;
+    bool contradiction_ = false; // set by the rules as soon as the board cannot be solved
+    const std::atomic<bool>* cancel_ = nullptr;
+    sudoku::Status status_ = sudoku::Status::Unsolved;
+
+    static constexpr auto entity_sets = make_entity_sets<B>();
+    static constexpr auto sets = make_sets<B>();
+    static constexpr auto peers = make_peers<B>();
+    static constexpr auto unit_masks = make_unit_masks<B>();
 };
 
-std::ostream& operator<<(std::ostream& os, const Puzzle& p);
+using Puzzle = BasicPuzzle<3>;
+
+extern template class BasicPuzzle<2>;
+extern template class BasicPuzzle<3>;
+extern template class BasicPuzzle<4>;
+extern template class BasicPuzzle<5>;
@@ -0,0 +1,156 @@
+#include "PuzzleArchive.h"
+#include "bit_ops.h"
+#include <algorithm>
+
+//===============================================================================
+PackedGrid PackedGrid::pack(const std::string& grid) {
+    // same values as symbol_value<3>(), without the search through the symbol table
+    auto value = [](char c) {
+        const unsigned v = static_cast<unsigned char>(c - '0');
+        return v <= 9 ? v : 0u;
+    };
+
+    PackedGrid p;
+    const char* g = grid.data();
+    for (std::size_t b = 0; b < 40; ++b) {
+        p.bytes[b] = static_cast<std::uint8_t>(value(g[2 * b]) | (value(g[2 * b + 1]) << 4));
+    }
+    p.bytes[40] = static_cast<std::uint8_t>(value(g[80]));
+    return p;
+}
+
+//===============================================================================
+PackedGrid PackedGrid::overflow(std::uint32_t index) {
+    PackedGrid p;
+    for (unsigned b = 0; b < 4; ++b) p.bytes[b] = static_cast<std::uint8_t>(index >> (8 * b));
+    p.bytes[num_bytes - 1] = 0xF0;
+    return p;
+}
+
+//===============================================================================
+std::uint32_t PackedGrid::overflow_index() const {
+    std::uint32_t index = 0;
+    for (unsigned b = 0; b < 4; ++b) index |= std::uint32_t(bytes[b]) << (8 * b);
+    return index;
+}
+
+//===============================================================================
+std::string PackedGrid::unpack() const {
+    std::string s(81, '.');
+    for (std::size_t i = 0; i < 81; ++i) {
+        const unsigned v = (bytes[i / 2] >> (4 * (i % 2))) & 0xF;
+        if (v != 0) s[i] = value_symbols[v - 1];
+    }
+    return s;
+}
+
+//===============================================================================
+void PuzzleArchive::add(const std::string& grid) {
+    if (PackedGrid::packable(grid)) {
+        records_.push_back(PackedGrid::pack(grid));
+        return;
+    }
+    records_.push_back(PackedGrid::overflow(static_cast<std::uint32_t>(other_.size())));
+    other_.push_back(grid);
+}
+
+//===============================================================================
+bool PuzzleArchive::add_line(const std::string& line) {
+    if (line.rfind("#", 0) == 0) return false;
+    const bool cr = !line.empty() && line.back() == '\r';
+
+    switch (line.size() - (cr ? 1 : 0)) {
+    case 16: case 81: case 256: case 625:
+        add(cr ? line.substr(0, line.size() - 1) : line);
+        return true;
+    default:
+        return false;
+    }
+}
+
+//===============================================================================
+std::string PuzzleArchive::operator[](std::size_t i) const {
+    const PackedGrid& p = records_[i];
+    return p.is_overflow() ? other_[p.overflow_index()] : p.unpack();
+}
+
+//===============================================================================
+void PuzzleArchive::sort() {
+    std::sort(records_.begin(), records_.end());
+}
+
+//===============================================================================
+std::size_t PuzzleArchive::memory_bytes() const {
+    std::size_t bytes = records_.capacity() * sizeof(PackedGrid) + other_.capacity() * sizeof(std::string);
+    for (const auto& s : other_) bytes += s.capacity();
+    return bytes;
+}
+
+//===============================================================================
+ResultTable::ResultTable(std::size_t n)
+    : status_(n, sudoku::Status::Unsolved), solution_(n), elapsed_ms_(n), guesses_(n), undo_bytes_(n), cache_hit_(n) {
+    for (auto& c : rule_calls_) c.resize(n);
+    for (auto& c : rule_applies_) c.resize(n);
+}
+
+//===============================================================================
+void ResultTable::set(std::size_t i, const sudoku::Result& result) {
+    const sudoku::Stats& st = result.stats;
+    status_[i] = result.status;
+    elapsed_ms_[i] = st.elapsed_ms;
+    guesses_[i] = st.guesses;
+    undo_bytes_[i] = st.undo_bytes;
+    cache_hit_[i] = st.cache_hit;
+    for (unsigned r = 0; r < sudoku::num_rules; ++r) {
+        rule_calls_[r][i] = st.rule_calls[r];
+        rule_applies_[r][i] = st.rule_applies[r];
+    }
+
+    if (result.solution.empty()) {
+        solution_[i] = PackedGrid();
+    }
+    else if (PackedGrid::packable(result.solution)) {
+        solution_[i] = PackedGrid::pack(result.solution);
+    }
+    else {
+        /* Only other board sizes take the lock */
+        std::lock_guard<std::mutex> lock(other_mutex_);
+        solution_[i] = PackedGrid::overflow(static_cast<std::uint32_t>(other_.size()));
+        other_.push_back(result.solution);
+    }
+}
+
+//===============================================================================
+sudoku::Result ResultTable::get(std::size_t i) const {
+    sudoku::Result r;
+    r.status = status_[i];
+    r.stats.elapsed_ms = elapsed_ms_[i];
+    r.stats.guesses = guesses_[i];
+    r.stats.undo_bytes = undo_bytes_[i];
+    r.stats.cache_hit = cache_hit_[i] != 0;
+    for (unsigned k = 0; k < sudoku::num_rules; ++k) {
+        r.stats.rule_calls[k] = rule_calls_[k][i];
+        r.stats.rule_applies[k] = rule_applies_[k][i];
+    }
+
+    const PackedGrid& p = solution_[i];
+    if (p.is_overflow()) {
+        std::lock_guard<std::mutex> lock(other_mutex_);
+        r.solution = other_[p.overflow_index()];
+    }
+    else if (r.status == sudoku::Status::Solved) {
+        r.solution = p.unpack();
+    }
+    return r;
+}
+
+//===============================================================================
+std::size_t ResultTable::memory_bytes() const {
+    const std::size_t n = size();
+    std::size_t bytes = n * (sizeof(sudoku::Status) + sizeof(PackedGrid) + sizeof(double)
+        + sizeof(std::uint32_t) + sizeof(std::uint64_t) + sizeof(std::uint8_t)
+        + 2 * sudoku::num_rules * sizeof(std::uint32_t));
+    std::lock_guard<std::mutex> lock(other_mutex_);
+    for (const auto& s : other_) bytes += sizeof(std::string) + s.capacity();
+    return bytes;
+}
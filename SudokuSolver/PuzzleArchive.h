@@ -0,0 +1,95 @@
+#pragma once
+
+#include "sudoku.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+A 9x9 grid in 41 bytes: one nibble per cell, 0 for an empty cell and 1-9
+for a value, two cells to a byte in row order. The high nibble of the
+last byte is spare; PackedGrid::overflow() sets it to mark a record whose
+grid is another size and is kept out of line (the first four bytes then
+hold its index), so archives of mixed sizes still get one fixed-size
+record per puzzle.
+
+Empty cells come back as '.', whatever character the input used.
+*/
+struct PackedGrid {
+    static constexpr std::size_t num_bytes = 41;
+
+    std::array<std::uint8_t, num_bytes> bytes{};
+
+    // True for 81-character grids, the ones pack() accepts
+    static bool packable(const std::string& grid) { return grid.size() == 81; }
+    static PackedGrid pack(const std::string& grid);
+    static PackedGrid overflow(std::uint32_t index);
+
+    std::string unpack() const;
+    bool is_overflow() const { return (bytes[num_bytes - 1] >> 4) == 0xF; }
+    std::uint32_t overflow_index() const;
+
+    bool operator==(const PackedGrid& rhs) const { return bytes == rhs.bytes; }
+    bool operator<(const PackedGrid& rhs) const { return bytes < rhs.bytes; }
+};
+
+/*
+The puzzles of a batch, one PackedGrid per puzzle. A million 9x9 puzzles
+take 41 MB in one contiguous block, against well over 100 MB as separate
+strings, and sort() orders them without touching the heap.
+*/
+class PuzzleArchive {
+public:
+    void add(const std::string& grid);
+    // Adds a line of an input file if it holds a puzzle; '#' comments and other lengths are skipped
+    bool add_line(const std::string& line);
+    void reserve(std::size_t n) { records_.reserve(n); }
+    void resize(std::size_t n) { records_.resize(n); }
+
+    std::string operator[](std::size_t i) const;
+    std::size_t size() const { return records_.size(); }
+    bool empty() const { return records_.empty(); }
+
+    // Packed order, which puts duplicate puzzles next to each other
+    void sort();
+
+    std::size_t memory_bytes() const;
+
+private:
+    std::vector<PackedGrid> records_;
+    std::vector<std::string> other_; // grids that are not 9x9
+};
+
+/*
+Per-puzzle results of a batch, one column per field rather than one
+sudoku::Result (with its own solution string) per puzzle. Solutions are
+packed like the puzzles and only kept for solved puzzles.
+
+set() may be called from several threads at once for different indices.
+*/
+class ResultTable {
+public:
+    explicit ResultTable(std::size_t n = 0);
+
+    void set(std::size_t i, const sudoku::Result& result);
+    sudoku::Result get(std::size_t i) const;
+    std::size_t size() const { return status_.size(); }
+
+    std::size_t memory_bytes() const;
+
+private:
+    std::vector<sudoku::Status> status_;
+    std::vector<PackedGrid> solution_;
+    std::vector<double> elapsed_ms_;
+    std::vector<std::uint32_t> guesses_;
+    std::vector<std::uint64_t> undo_bytes_;
+    std::vector<std::uint8_t> cache_hit_;
+    std::array<std::vector<std::uint32_t>, sudoku::num_rules> rule_calls_;
+    std::array<std::vector<std::uint32_t>, sudoku::num_rules> rule_applies_;
+
+    mutable std::mutex other_mutex_;
+    std::vector<std::string> other_; // solutions that are not 9x9
+};
@@ -0,0 +1,287 @@
+
+#include "ResultWriter.h"
+#include "TextFormat.h"
+#include "Trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+//===============================================================================
+void append_json_string(std::string& out, const std::string& s) {
+    out += '"';
+
+    // puzzles never need escaping, so copy them in one go when they don't
+    const bool plain = std::none_of(s.begin(), s.end(), [](char c) {
+        return c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20;
+    });
+    if (plain) {
+        out += s;
+        out += '"';
+        return;
+    }
+
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        }
+        else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+//===============================================================================
+void append_csv_field(std::string& out, const std::string& s) {
+    // puzzles never need quoting, but keep the file parseable if one does
+    if (s.find_first_of(",\"\n\r") == std::string::npos) {
+        out += s;
+        return;
+    }
+    out += '"';
+    for (char c : s) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    out += '"';
+}
+
+//===============================================================================
+void append_number(std::string& out, unsigned v) {
+    char buf[20];
+    out.append(buf, format_uint(buf, v));
+}
+
+//===============================================================================
+void append_ms(std::string& out, double v) {
+    char buf[32];
+    out.append(buf, format_ms(buf, v));
+}
+
+} // namespace
+
+//===============================================================================
+ResultWriter::ResultWriter(const std::string& path, Format format, std::size_t flush_bytes, std::uint64_t resume_at)
+    : path_(path), format_(format), flush_bytes_(flush_bytes) {
+    if (resume_at > 0) {
+        /* Drop anything written after the checkpoint, it is solved again */
+        std::error_code ec;
+        if (std::filesystem::file_size(path, ec) < resume_at || ec) {
+            throw std::runtime_error("Result file " + path + " is shorter than its checkpoint");
+        }
+        std::filesystem::resize_file(path, resume_at);
+        out_.open(path, std::ios::binary | std::ios::app);
+    }
+    else {
+        out_.open(path, std::ios::binary | std::ios::trunc);
+    }
+    if (!out_.is_open()) {
+        throw std::runtime_error("Could not open result file " + path);
+    }
+
+    if (format_ == Format::Csv && resume_at == 0) {
+        pending_ = "puzzle,status,solution,time_ms,guesses";
+        for (unsigned i = 1; i <= sudoku::num_rules; ++i) {
+            pending_ += ",rule" + std::to_string(i) + "_calls,rule" + std::to_string(i) + "_applies";
+        }
+        pending_ += '\n';
+    }
+    written_ = synced_ = resume_at;
+    queued_ = resume_at + pending_.size();
+
+    thread_ = std::thread(&ResultWriter::run, this);
+}
+
+//===============================================================================
+ResultWriter::~ResultWriter() {
+    close();
+}
+
+//===============================================================================
+ResultWriter::Format ResultWriter::format_for(const std::string& path) {
+    const auto dot = path.rfind('.');
+    if (dot != std::string::npos) {
+        const std::string ext = path.substr(dot);
+        if (ext == ".json" || ext == ".jsonl") return Format::Jsonl;
+    }
+    return Format::Csv;
+}
+
+//===============================================================================
+void ResultWriter::format_record(std::string& out, Format format, const std::string& puzzle, const sudoku::Result& result) {
+    const sudoku::Stats& st = result.stats;
+
+    if (format == Format::Csv) {
+        append_csv_field(out, puzzle);
+        out += ',';
+        out += sudoku::status_name(result.status);
+        out += ',';
+        out += result.solution;
+        out += ',';
+        append_ms(out, st.elapsed_ms);
+        out += ',';
+        append_number(out, st.guesses);
+        for (unsigned i = 0; i < sudoku::num_rules; ++i) {
+            out += ',';
+            append_number(out, st.rule_calls[i]);
+            out += ',';
+            append_number(out, st.rule_applies[i]);
+        }
+    }
+    else {
+        out += "{\"puzzle\":";
+        append_json_string(out, puzzle);
+        out += ",\"status\":\"";
+        out += sudoku::status_name(result.status);
+        out += "\",\"solution\":\"";
+        out += result.solution;
+        out += "\",\"time_ms\":";
+        append_ms(out, st.elapsed_ms);
+        out += ",\"guesses\":";
+        append_number(out, st.guesses);
+        out += ",\"rule_calls\":[";
+        for (unsigned i = 0; i < sudoku::num_rules; ++i) {
+            if (i > 0) out += ',';
+            append_number(out, st.rule_calls[i]);
+        }
+        out += "],\"rule_applies\":[";
+        for (unsigned i = 0; i < sudoku::num_rules; ++i) {
+            if (i > 0) out += ',';
+            append_number(out, st.rule_applies[i]);
+        }
+        out += "]}";
+    }
+    out += '\n';
+}
+
+//===============================================================================
+void ResultWriter::write(const std::string& puzzle, const sudoku::Result& result) {
+    SUDOKU_TRACE_SCOPE("output");
+    // format outside the lock so writers only contend on the append
+    std::string record;
+    record.reserve(256);
+    format_record(record, format_, puzzle, result);
+    write_records(record);
+}
+
+//===============================================================================
+void ResultWriter::write_records(const std::string& records) {
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_ += records;
+        queued_ += records.size();
+        wake = pending_.size() >= flush_bytes_;
+    }
+    if (wake) cv_.notify_one();
+}
+
+//===============================================================================
+std::uint64_t ResultWriter::sync() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    const std::uint64_t target = queued_;
+    sync_requested_ = true;
+    cv_.notify_one();
+    synced_cv_.wait(lock, [&] { return synced_ >= target || closing_ || failed_; });
+    if (failed_) {
+        throw std::runtime_error("Could not write result file " + path_);
+    }
+    return target;
+}
+
+//===============================================================================
+bool ResultWriter::sync_file(const std::string& path) {
+#ifdef _WIN32
+    const int fd = ::_open(path.c_str(), _O_WRONLY | _O_BINARY);
+    if (fd < 0) return false;
+    const bool ok = ::_commit(fd) == 0;
+    ::_close(fd);
+#else
+    // fsync writes back the file's data whichever descriptor asks
+    const int fd = ::open(path.c_str(), O_WRONLY);
+    if (fd < 0) return false;
+    const bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+#endif
+    return ok;
+}
+
+//===============================================================================
+bool ResultWriter::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closing_) return !failed_;
+        closing_ = true;
+    }
+    cv_.notify_one();
+    if (thread_.joinable()) thread_.join();
+    out_.close();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    failed_ = failed_ || out_.fail();
+    return !failed_;
+}
+
+//===============================================================================
+void ResultWriter::run() {
+    /*
+    Swap the pending buffer out under the lock and write it without holding
+    it. Wakes when enough data has built up, when closing, when sync() is
+    waiting, or every so often so a long batch still shows progress on disk.
+    */
+    std::string buffer;
+    bool done = false;
+
+    while (!done) {
+        bool syncing = false;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait_for(lock, std::chrono::milliseconds(200), [this] {
+                return closing_ || sync_requested_ || pending_.size() >= flush_bytes_;
+            });
+            buffer.swap(pending_);
+            done = closing_;
+            syncing = sync_requested_;
+            sync_requested_ = false;
+        }
+
+        const std::uint64_t written = buffer.size();
+        if (!buffer.empty()) {
+            out_.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            buffer.clear();
+        }
+        if (syncing) out_.flush();
+        // a flush only reaches the OS; the checkpoint counts on the records surviving a power cut too
+        const bool failed = !out_ || (syncing && !sync_file(path_));
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            written_ += written;
+            if (syncing) synced_ = written_;
+            failed_ = failed_ || failed;
+        }
+        if (syncing || failed) synced_cv_.notify_all();
+    }
+
+    out_.flush();
+    std::lock_guard<std::mutex> lock(mutex_);
+    failed_ = failed_ || !out_;
+}
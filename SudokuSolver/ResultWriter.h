@@ -0,0 +1,80 @@
+#pragma once
+
+#include "sudoku.h"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/*
+Writes one record per solved puzzle (puzzle, status, solution, time, guesses
+and the per-rule counters) as CSV or JSON lines.
+
+Records are formatted on the calling thread and appended to an in-memory
+buffer under a short lock; a background thread does the file writes, so
+solver threads never wait on the disk. Safe to call write() from several
+threads at once.
+
+A file that can't be opened throws std::runtime_error. Once a write fails
+(a full disk, say) the records after it are dropped; sync() throws and
+close() returns false, so the caller can report it.
+
+A non-zero resume_at reopens an existing file, cuts it back to that many
+bytes (the end of the last record a checkpoint counted) and appends from
+there without a new header.
+*/
+class ResultWriter {
+public:
+    enum class Format { Csv, Jsonl };
+
+    static constexpr std::size_t default_flush_bytes = 1 << 20;
+
+    ResultWriter(const std::string& path, Format format, std::size_t flush_bytes = default_flush_bytes, std::uint64_t resume_at = 0);
+    ResultWriter(const ResultWriter&) = delete;
+    ResultWriter& operator=(const ResultWriter&) = delete;
+    ~ResultWriter();
+
+    void write(const std::string& puzzle, const sudoku::Result& result);
+    // Append records already formatted with format_record() in this writer's format
+    void write_records(const std::string& records);
+
+    /*
+    Wait until every record written so far is on disk (flushed and fsync'd);
+    returns the file size. Throws std::runtime_error if a write has failed
+    */
+    std::uint64_t sync();
+
+    // Write out everything buffered so far and stop the background thread; false if a write failed
+    bool close();
+
+    // Push the data already written to the file at path out to the disk; false if that fails
+    static bool sync_file(const std::string& path);
+
+    // Jsonl for ".json"/".jsonl" paths, Csv otherwise
+    static Format format_for(const std::string& path);
+
+    static void format_record(std::string& out, Format format, const std::string& puzzle, const sudoku::Result& result);
+
+private:
+    void run();
+
+    std::ofstream out_;
+    const std::string path_;
+    const Format format_;
+    const std::size_t flush_bytes_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable synced_cv_;
+    std::string pending_;
+    std::uint64_t queued_ = 0;  // file size once pending_ is written
+    std::uint64_t written_ = 0; // file size once the stream is flushed
+    std::uint64_t synced_ = 0;  // file size at the last sync
+    bool sync_requested_ = false;
+    bool closing_ = false;
+    bool failed_ = false;
+    std::thread thread_;
+};
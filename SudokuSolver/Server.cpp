@@ -0,0 +1,395 @@
+
+#include "Server.h"
+#include "ResultWriter.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+#ifdef MSG_NOSIGNAL
+constexpr int send_flags = MSG_NOSIGNAL;
+#else
+constexpr int send_flags = 0;
+#endif
+
+//===============================================================================
+bool send_all(int fd, const char* data, std::size_t size) {
+    while (size > 0) {
+        const ssize_t n = ::send(fd, data, size, send_flags);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+//===============================================================================
+sockaddr_un make_address(const std::string& path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("Socket path too long: " + path);
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return addr;
+}
+
+//===============================================================================
+std::uint64_t micros_since(std::chrono::steady_clock::time_point start) {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count());
+}
+
+} // namespace
+
+//===============================================================================
+unsigned LatencyHistogram::bucket(std::uint64_t us) {
+    // exact below 8us, then 8 linear steps per power of two
+    if (us < sub_buckets) return static_cast<unsigned>(us);
+
+    unsigned msb = 0;
+    for (std::uint64_t v = us; v > 1; v >>= 1) ++msb;
+
+    const unsigned sub = static_cast<unsigned>(us >> (msb - 3)) & (sub_buckets - 1);
+    return (msb - 2) * sub_buckets + sub;
+}
+
+//===============================================================================
+std::uint64_t LatencyHistogram::bucket_limit(unsigned b) {
+    if (b < sub_buckets) return b;
+
+    const unsigned msb = b / sub_buckets + 2;
+    const std::uint64_t sub = b % sub_buckets;
+    const std::uint64_t lower = (sub_buckets + sub) << (msb - 3);
+    return lower + (std::uint64_t(1) << (msb - 3)) - 1;
+}
+
+//===============================================================================
+void LatencyHistogram::record(std::uint64_t us) {
+    buckets_[bucket(us)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    total_.fetch_add(us, std::memory_order_relaxed);
+
+    std::uint64_t prev = max_.load(std::memory_order_relaxed);
+    while (prev < us && !max_.compare_exchange_weak(prev, us, std::memory_order_relaxed)) {}
+}
+
+//===============================================================================
+double LatencyHistogram::mean() const {
+    const std::uint64_t n = count();
+    return n > 0 ? double(total_.load(std::memory_order_relaxed)) / n : 0.0;
+}
+
+//===============================================================================
+std::uint64_t LatencyHistogram::percentile(double p) const {
+    const std::uint64_t n = count();
+    if (n == 0) return 0;
+
+    std::uint64_t target = static_cast<std::uint64_t>(p / 100.0 * n + 0.999999);
+    if (target < 1) target = 1;
+
+    std::uint64_t seen = 0;
+    for (unsigned b = 0; b < num_buckets; ++b) {
+        seen += buckets_[b].load(std::memory_order_relaxed);
+        if (seen >= target) {
+            const std::uint64_t limit = bucket_limit(b);
+            return limit < max() ? limit : max();
+        }
+    }
+    return max();
+}
+
+//===============================================================================
+struct Server::Connection {
+    explicit Connection(int f) : fd(f) {}
+
+    const int fd;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::string> outgoing;
+    std::size_t in_flight = 0;
+    bool reading = true;
+};
+
+//===============================================================================
+Server::Server(const std::string& socket_path, const ServerConfig& config)
+    : path_(socket_path), config_(config),
+    cache_(config.cache_entries > 0 ? std::make_unique<SolutionCache>(config.cache_entries) : nullptr),
+    pool_(config.threads, config.queue_capacity, config.max_batch, config.options, cache_.get()) {
+}
+
+//===============================================================================
+Server::~Server() {
+    stop();
+}
+
+//===============================================================================
+void Server::start() {
+    const sockaddr_un addr = make_address(path_);
+
+    listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) {
+        throw std::runtime_error("Could not create socket");
+    }
+
+    ::unlink(path_.c_str());
+    if (::bind(listen_fd_, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(listen_fd_, 64) < 0) {
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+        throw std::runtime_error("Could not listen on " + path_ + ": " + std::strerror(errno));
+    }
+
+    running_ = true;
+    accept_thread_ = std::thread(&Server::accept_loop, this);
+}
+
+//===============================================================================
+void Server::stop() {
+    if (!running_.exchange(false)) return;
+
+    if (accept_thread_.joinable()) accept_thread_.join();
+    ::close(listen_fd_);
+    listen_fd_ = -1;
+    ::unlink(path_.c_str());
+
+    // wake the readers; each connection drains its replies before closing
+    {
+        std::unique_lock<std::mutex> lock(connections_mutex_);
+        for (auto& c : connections_) ::shutdown(c->fd, SHUT_RD);
+        connections_done_.wait(lock, [this] { return connections_.empty(); });
+    }
+
+    pool_.shutdown();
+}
+
+//===============================================================================
+std::string Server::stats_json() const {
+    std::string s = "{\"connections\":" + std::to_string(connections_accepted_.load());
+    s += ",\"requests\":" + std::to_string(requests_.load());
+    s += ",\"completed\":" + std::to_string(completed_.load());
+    s += ",\"queue_depth\":" + std::to_string(pool_.queue_depth());
+    s += ",\"queue_capacity\":" + std::to_string(pool_.capacity());
+    if (cache_) {
+        s += ",\"cache_entries\":" + std::to_string(cache_->size());
+        s += ",\"cache_hits\":" + std::to_string(cache_->hits());
+        s += ",\"cache_misses\":" + std::to_string(cache_->misses());
+    }
+    s += ",\"latency_us\":{\"mean\":" + std::to_string(static_cast<std::uint64_t>(latency_.mean()));
+    s += ",\"p50\":" + std::to_string(latency_.percentile(50));
+    s += ",\"p90\":" + std::to_string(latency_.percentile(90));
+    s += ",\"p99\":" + std::to_string(latency_.percentile(99));
+    s += ",\"max\":" + std::to_string(latency_.max());
+    s += "}}";
+    return s;
+}
+
+//===============================================================================
+void Server::accept_loop() {
+    while (running_) {
+        pollfd pfd{ listen_fd_, POLLIN, 0 };
+        if (::poll(&pfd, 1, 100) <= 0) continue;
+
+        const int fd = ::accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) continue;
+
+        ++connections_accepted_;
+        auto conn = std::make_shared<Connection>(fd);
+
+        // connection threads are detached; stop() waits for the list to empty instead
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        connections_.push_back(conn);
+        std::thread(&Server::serve, this, conn).detach();
+    }
+}
+
+//===============================================================================
+void Server::serve(std::shared_ptr<Connection> conn) {
+    /*
+    Read request lines and hand puzzles to the pool. Replies are queued on
+    the connection and sent by a separate writer thread, so pool workers
+    never block on a slow client.
+    */
+    std::thread writer(&Server::write_loop, this, conn);
+
+    std::string buffer;
+    char chunk[4096];
+    std::uint64_t next_id = 0;
+    bool quit = false;
+
+    auto reject_line = [&] {
+        std::lock_guard<std::mutex> lock(conn->mutex);
+        conn->outgoing.push_back("{\"error\":\"line too long\"}\n");
+        conn->changed.notify_all();
+        quit = true;
+    };
+
+    while (!quit) {
+        const ssize_t n = ::recv(conn->fd, chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        buffer.append(chunk, static_cast<std::size_t>(n));
+
+        std::size_t begin = 0;
+        for (std::size_t end = buffer.find('\n'); end != std::string::npos; end = buffer.find('\n', begin)) {
+            if (end - begin > config_.max_line_bytes) {
+                reject_line();
+                break;
+            }
+            std::string line = buffer.substr(begin, end - begin);
+            begin = end + 1;
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+
+            if (line == "QUIT") {
+                quit = true;
+                break;
+            }
+
+            if (line == "STATS") {
+                std::lock_guard<std::mutex> lock(conn->mutex);
+                conn->outgoing.push_back(stats_json() + "\n");
+                conn->changed.notify_all();
+                continue;
+            }
+
+            // per-connection backpressure: wait for replies before taking more work
+            {
+                std::unique_lock<std::mutex> lock(conn->mutex);
+                conn->changed.wait(lock, [&] { return conn->in_flight < config_.max_in_flight; });
+                ++conn->in_flight;
+            }
+
+            ++requests_;
+            const std::uint64_t id = next_id++;
+            const auto received = std::chrono::steady_clock::now();
+
+            auto done = [this, conn, id, received](const std::string& puzzle, const sudoku::Result& r) {
+                const std::uint64_t latency = micros_since(received);
+                latency_.record(latency);
+                ++completed_;
+
+                std::string reply = "{\"id\":" + std::to_string(id) + ",\"latency_us\":" + std::to_string(latency) + ",";
+                std::string record;
+                ResultWriter::format_record(record, ResultWriter::Format::Jsonl, puzzle, r);
+                reply.append(record, 1, std::string::npos); // drop the record's opening brace
+
+                std::lock_guard<std::mutex> lock(conn->mutex);
+                conn->outgoing.push_back(std::move(reply));
+                --conn->in_flight;
+                conn->changed.notify_all();
+            };
+
+            if (!pool_.submit(std::move(line), done)) {
+                std::lock_guard<std::mutex> lock(conn->mutex);
+                --conn->in_flight;
+                quit = true;
+                break;
+            }
+        }
+        buffer.erase(0, begin);
+        if (!quit && buffer.size() > config_.max_line_bytes) reject_line();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(conn->mutex);
+        conn->reading = false;
+        conn->changed.notify_all();
+    }
+    writer.join();
+
+    // unlist before closing so stop() never shuts down a reused descriptor
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    for (auto it = connections_.begin(); it != connections_.end(); ++it) {
+        if (*it == conn) {
+            connections_.erase(it);
+            break;
+        }
+    }
+    ::close(conn->fd);
+    connections_done_.notify_all();
+}
+
+//===============================================================================
+void Server::write_loop(std::shared_ptr<Connection> conn) {
+    // send replies until the reader is done and nothing is left in flight
+    std::deque<std::string> batch;
+    bool ok = true;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(conn->mutex);
+            conn->changed.wait(lock, [&] {
+                return !conn->outgoing.empty() || (!conn->reading && conn->in_flight == 0);
+            });
+            if (conn->outgoing.empty()) return;
+            batch.swap(conn->outgoing);
+        }
+
+        std::string data;
+        for (auto& r : batch) data += r;
+        batch.clear();
+
+        // keep draining after a failed send so in-flight callbacks still complete
+        if (ok) ok = send_all(conn->fd, data.data(), data.size());
+    }
+}
+
+//===============================================================================
+ServerClient::ServerClient(const std::string& socket_path) {
+    const sockaddr_un addr = make_address(socket_path);
+
+    fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd_ < 0 || ::connect(fd_, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0) {
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+        throw std::runtime_error("Could not connect to " + socket_path);
+    }
+}
+
+//===============================================================================
+ServerClient::~ServerClient() {
+    if (fd_ >= 0) ::close(fd_);
+}
+
+//===============================================================================
+void ServerClient::send_line(const std::string& line) {
+    const std::string msg = line + "\n";
+    if (!send_all(fd_, msg.data(), msg.size())) {
+        throw std::runtime_error("Lost connection to server");
+    }
+}
+
+//===============================================================================
+void ServerClient::finish_sending() {
+    ::shutdown(fd_, SHUT_WR);
+}
+
+//===============================================================================
+bool ServerClient::read_line(std::string& line) {
+    while (true) {
+        const auto end = buffer_.find('\n');
+        if (end != std::string::npos) {
+            line = buffer_.substr(0, end);
+            buffer_.erase(0, end + 1);
+            return true;
+        }
+
+        char chunk[4096];
+        const ssize_t n = ::recv(fd_, chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        buffer_.append(chunk, static_cast<std::size_t>(n));
+    }
+}
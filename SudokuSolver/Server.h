@@ -0,0 +1,135 @@
+#pragma once
+
+#include "SolutionCache.h"
+#include "SolverPool.h"
+#include "sudoku.h"
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+Long running solver service on a Unix domain socket (POSIX only).
+
+Protocol, one line per message in each direction:
+  <puzzle>  solve it; the reply is a JSON object with a per-connection "id"
+            (0, 1, ... in request order), the end-to-end "latency_us" and the
+            same fields as a ResultWriter JSON line. Replies are sent as soon
+            as each puzzle is solved, so they may arrive out of order.
+  STATS     reply with the server counters, cache hit counts and latency
+            percentiles as JSON
+  QUIT      close the connection once all its replies have been sent
+
+A line longer than max_line_bytes gets the reply {"error":"line too long"}
+and the connection is closed, so a client can't make the server buffer
+without limit.
+
+Requests from every connection share one SolverPool. Each connection may
+have at most max_in_flight unanswered puzzles; past that the server stops
+reading from it until replies go out, and a full pool queue blocks all
+readers the same way.
+*/
+
+// Lock-free log-scale histogram of latencies in microseconds
+class LatencyHistogram {
+public:
+    void record(std::uint64_t us);
+
+    std::uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    std::uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+    double mean() const;
+
+    // Upper bound of the bucket holding the p-th percentile (p in 0..100), within 12.5%
+    std::uint64_t percentile(double p) const;
+
+private:
+    static constexpr unsigned sub_buckets = 8;
+    static constexpr unsigned num_buckets = 64 * sub_buckets;
+
+    static unsigned bucket(std::uint64_t us);
+    static std::uint64_t bucket_limit(unsigned b);
+
+    std::array<std::atomic<std::uint64_t>, num_buckets> buckets_{};
+    std::atomic<std::uint64_t> count_{ 0 };
+    std::atomic<std::uint64_t> total_{ 0 };
+    std::atomic<std::uint64_t> max_{ 0 };
+};
+
+struct ServerConfig {
+    unsigned threads = 1;
+    std::size_t queue_capacity = 1024;
+    std::size_t max_batch = 16;
+    std::size_t max_in_flight = 256; // per connection
+    std::size_t max_line_bytes = 4096; // several times the largest (25x25) grid
+    std::size_t cache_entries = 0;   // solution cache size, 0 to disable
+    sudoku::Options options;
+};
+
+class Server {
+public:
+    Server(const std::string& socket_path, const ServerConfig& config);
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+    ~Server();
+
+    // Bind and start accepting connections; throws std::runtime_error on socket errors
+    void start();
+
+    // Stop accepting, close every connection and wait for the workers
+    void stop();
+
+    std::string stats_json() const;
+    const LatencyHistogram& latency() const { return latency_; }
+
+private:
+    struct Connection;
+
+    void accept_loop();
+    void serve(std::shared_ptr<Connection> conn);
+    void write_loop(std::shared_ptr<Connection> conn);
+
+    const std::string path_;
+    const ServerConfig config_;
+    std::unique_ptr<SolutionCache> cache_;
+    SolverPool pool_;
+
+    int listen_fd_ = -1;
+    std::atomic<bool> running_{ false };
+    std::thread accept_thread_;
+
+    std::mutex connections_mutex_;
+    std::condition_variable connections_done_;
+    std::vector<std::shared_ptr<Connection>> connections_;
+
+    std::atomic<std::uint64_t> connections_accepted_{ 0 };
+    std::atomic<std::uint64_t> requests_{ 0 };
+    std::atomic<std::uint64_t> completed_{ 0 };
+    LatencyHistogram latency_;
+};
+
+// Minimal blocking client for the server protocol
+class ServerClient {
+public:
+    explicit ServerClient(const std::string& socket_path);
+    ServerClient(const ServerClient&) = delete;
+    ServerClient& operator=(const ServerClient&) = delete;
+    ~ServerClient();
+
+    void send_line(const std::string& line);
+
+    // Signal that no more requests are coming; replies can still be read
+    void finish_sending();
+
+    // False once the server has closed the connection
+    bool read_line(std::string& line);
+
+private:
+    int fd_ = -1;
+    std::string buffer_;
+};
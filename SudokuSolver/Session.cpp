@@ -0,0 +1,107 @@
+
+#include "Session.h"
+#include "bit_ops.h"
+#include <stdexcept>
+
+//===============================================================================
+Session::Session(const std::string& grid, const sudoku::Options& options)
+    : options_(options), base_(grid), givens_(grid) {
+    if (grid.size() != Puzzle::NumCells) {
+        throw std::runtime_error("Invalid puzzle size");
+    }
+    rebuild();
+}
+
+//===============================================================================
+void Session::rebuild() {
+    puzzle_ = std::make_unique<Puzzle>(base_);
+    puzzle_->set_rules(options_.rules);
+    base_status_ = puzzle_->propagate();
+    edits_.clear();
+    status_ = base_status_;
+}
+
+//===============================================================================
+sudoku::Status Session::set_given(unsigned cell, unsigned value) {
+    if (cell >= Puzzle::NumCells || value < 1 || value > Puzzle::N) {
+        throw std::runtime_error("Invalid cell or value");
+    }
+    if (symbol_value<3>(givens_[cell]) == value) return status_;
+    if (symbol_value<3>(givens_[cell]) != 0) clear_given(cell);
+
+    solved_.reset();
+    givens_[cell] = value_symbols[value - 1];
+
+    edits_.push_back(Edit{ cell, value, place(cell, value) });
+    return status_ = current_status();
+}
+
+//===============================================================================
+sudoku::Status Session::place(unsigned cell, unsigned value) {
+    /*
+    A conflicting given leaves its value off the board, so the board alone
+    no longer shows the contradiction. Keep NoSolution for every edit made
+    on top of it (the edit is still logged, so undoing stays in step) until
+    the conflicting one is cleared
+    */
+    const sudoku::Status before = current_status();
+    const sudoku::Status s = puzzle_->place(cell, value);
+    return before == sudoku::Status::NoSolution ? before : s;
+}
+
+//===============================================================================
+sudoku::Status Session::clear_given(unsigned cell) {
+    if (cell >= Puzzle::NumCells) {
+        throw std::runtime_error("Invalid cell");
+    }
+    if (symbol_value<3>(givens_[cell]) == 0) return status_;
+
+    solved_.reset();
+    givens_[cell] = '.';
+
+    std::size_t k = edits_.size();
+    while (k > 0 && edits_[k - 1].cell != cell) --k;
+
+    if (k == 0) {
+        /* One of the base givens: nothing to undo back to, so start again */
+        base_ = givens_;
+        rebuild();
+        return status_;
+    }
+
+    /* Undo back to the edit and replay the ones after it */
+    std::vector<Edit> later(edits_.begin() + k, edits_.end());
+    while (edits_.size() >= k) {
+        puzzle_->undo_place();
+        edits_.pop_back();
+    }
+    for (const Edit& e : later) {
+        edits_.push_back(Edit{ e.cell, e.value, place(e.cell, e.value) });
+    }
+    return status_ = current_status();
+}
+
+//===============================================================================
+sudoku::Result Session::solve() {
+    if (solved_) return *solved_;
+
+    sudoku::Result r;
+    if (status_ == sudoku::Status::Unsolved) {
+        // search on a copy so the propagated state and the edit log stay as they are
+        Puzzle p(givens_, puzzle_->state());
+        p.set_time_limit(options_.timeout_ms);
+        p.set_undo_mode(options_.undo);
+        p.set_branching(options_.branching);
+        p.set_rules(options_.rules);
+        p.solve();
+        r = p.result();
+    }
+    else {
+        r.status = status_;
+        if (status_ == sudoku::Status::Solved) r.solution = puzzle_->solution();
+        r.stats = puzzle_->stats();
+    }
+
+    solved_ = std::make_unique<sudoku::Result>(r);
+    return r;
+}
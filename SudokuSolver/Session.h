@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Puzzle.h"
+#include "sudoku.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+A 9x9 puzzle that is edited one given at a time, as in an interactive
+front end.
+
+The session keeps the board propagated with the rules (no guessing) along
+with the per-rule counters. Each set_given() is logged on the puzzle's
+trail, so clearing the most recent given just undoes its changes. Clearing
+an older given undoes back to it and replays the edits made after it.
+Clearing one of the givens the session was created with rebuilds the
+board. solve() only searches from the propagated state, and its result is
+kept until the next edit.
+*/
+class Session {
+public:
+    explicit Session(const std::string& grid, const sudoku::Options& options = sudoku::Options());
+
+    // Set (or change) the given of a cell, value 1..9; returns the propagated status
+    sudoku::Status set_given(unsigned cell, unsigned value);
+    // Remove the given of a cell, if it has one; returns the propagated status
+    sudoku::Status clear_given(unsigned cell);
+
+    // Solved, NoSolution, or Unsolved when the rules alone get stuck
+    sudoku::Status status() const { return status_; }
+    const std::string& givens() const { return givens_; }
+    // The propagated board, '.' for cells with more than one option
+    std::string board() const { return puzzle_->solution(); }
+    // Rule counters over the initial propagation and every edit since
+    sudoku::Stats stats() const { return puzzle_->stats(); }
+
+    // Full solve from the propagated state
+    sudoku::Result solve();
+
+private:
+    struct Edit {
+        unsigned cell;
+        unsigned value;
+        sudoku::Status status; // after this edit
+    };
+
+    void rebuild();
+    sudoku::Status place(unsigned cell, unsigned value);
+    sudoku::Status current_status() const { return edits_.empty() ? base_status_ : edits_.back().status; }
+
+    const sudoku::Options options_;
+    std::string base_;   // givens the board was last built from
+    std::string givens_; // base_ plus the edits
+    std::unique_ptr<Puzzle> puzzle_;
+    sudoku::Status base_status_ = sudoku::Status::Unsolved;
+    sudoku::Status status_ = sudoku::Status::Unsolved;
+    std::vector<Edit> edits_;
+    std::unique_ptr<sudoku::Result> solved_;
+};
@@ -0,0 +1,318 @@
+#include "Shard.h"
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+const char* const reply_magic = "sudoku-shard";
+constexpr unsigned reply_version = 1;
+
+using Clock = std::chrono::steady_clock;
+
+// A running worker process and what it has sent so far
+struct Task {
+    std::size_t shard;
+    pid_t pid;
+    int fd;
+    Clock::time_point start;
+    std::string reply;
+    bool eof = false;
+};
+
+//===============================================================================
+pid_t launch(const std::vector<std::string>& argv, int& read_fd) {
+    int fds[2];
+    if (::pipe(fds) != 0) {
+        throw std::runtime_error(std::string("Could not create a pipe: ") + std::strerror(errno));
+    }
+    // the read end stays out of later workers
+    ::fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+
+    std::vector<char*> args;
+    for (const auto& a : argv) args.push_back(const_cast<char*>(a.c_str()));
+    args.push_back(nullptr);
+
+    const pid_t pid = ::fork();
+    if (pid < 0) {
+        ::close(fds[0]);
+        ::close(fds[1]);
+        throw std::runtime_error(std::string("Could not start a worker: ") + std::strerror(errno));
+    }
+    if (pid == 0) {
+        ::dup2(fds[1], STDOUT_FILENO);
+        ::close(fds[0]);
+        ::close(fds[1]);
+        ::execvp(args[0], args.data());
+        ::_exit(127);
+    }
+
+    ::close(fds[1]);
+    read_fd = fds[0];
+    return pid;
+}
+
+//===============================================================================
+bool reap(pid_t pid) {
+    // true if the worker exited normally with status 0
+    int status = 0;
+    while (::waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) return false;
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+//===============================================================================
+double median(std::vector<double> v) {
+    std::sort(v.begin(), v.end());
+    return v[v.size() / 2];
+}
+
+} // namespace
+
+//===============================================================================
+std::vector<ShardRange> split_shards(const std::string& path, unsigned count) {
+    std::error_code ec;
+    const std::uint64_t size = std::filesystem::file_size(path, ec);
+    if (ec) {
+        throw std::runtime_error("Could not read " + path);
+    }
+
+    count = std::max(1u, count);
+    std::vector<ShardRange> shards;
+    for (unsigned k = 0; k < count; ++k) {
+        const std::uint64_t begin = size * k / count;
+        const std::uint64_t end = size * (k + 1) / count;
+        if (end > begin) shards.push_back(ShardRange{ path, begin, end });
+    }
+    return shards;
+}
+
+//===============================================================================
+PuzzleArchive read_shard(const ShardRange& range) {
+    std::ifstream in(range.path, std::ios::binary);
+    if (!in.is_open()) {
+        throw std::runtime_error("Could not open " + range.path);
+    }
+
+    /* A line that starts before the range belongs to the shard before */
+    std::uint64_t pos = range.begin;
+    if (pos > 0) {
+        in.seekg(static_cast<std::streamoff>(pos - 1));
+        std::string rest;
+        std::getline(in, rest);
+        pos += rest.size();
+    }
+
+    PuzzleArchive puzzles;
+    std::string line;
+    while (pos < range.end && std::getline(in, line)) {
+        pos += line.size() + 1;
+        puzzles.add_line(line);
+    }
+    return puzzles;
+}
+
+//===============================================================================
+void write_shard_result(std::ostream& out, const ShardResult& result) {
+    out << reply_magic << ' ' << reply_version << '\n';
+    out << "records " << result.records.size() << '\n';
+    out.write(result.records.data(), static_cast<std::streamsize>(result.records.size()));
+    result.stats.save(out);
+    out << "puzzles " << result.puzzles.size() << '\n';
+    for (const auto& p : result.puzzles) out << p.first << ' ' << p.second << '\n';
+    out << "end\n";
+}
+
+//===============================================================================
+bool read_shard_result(const std::string& data, ShardResult& result) {
+    std::istringstream in(data);
+
+    std::string word;
+    unsigned version = 0;
+    std::size_t size = 0;
+    if (!(in >> word >> version) || word != reply_magic || version != reply_version) return false;
+    if (!(in >> word >> size) || word != "records" || in.get() != '\n') return false;
+
+    result.records.resize(size);
+    if (!in.read(&result.records[0], static_cast<std::streamsize>(size))) return false;
+
+    try {
+        result.stats = BatchStats::load(in);
+    }
+    catch (std::exception&) {
+        return false;
+    }
+
+    if (!(in >> word >> size) || word != "puzzles") return false;
+    result.puzzles.clear();
+    for (std::size_t k = 0; k < size; ++k) {
+        int index = 0;
+        std::string puzzle;
+        if (!(in >> index >> puzzle)) return false;
+        result.puzzles[index] = puzzle;
+    }
+    return (in >> word) && word == "end" && in.get() == '\n';
+}
+
+//===============================================================================
+CoordinatorReport run_shards(const std::vector<ShardRange>& shards, const CoordinatorConfig& config,
+    const std::function<void(std::size_t, ShardResult&)>& on_result) {
+    /*
+    Single-threaded: poll() on the workers' pipes, with a short timeout so
+    slow shards are noticed even while no worker is sending anything
+    */
+    CoordinatorReport report;
+    const std::size_t n = shards.size();
+
+    std::deque<std::size_t> queue;
+    for (std::size_t k = 0; k < n; ++k) queue.push_back(k);
+
+    std::vector<unsigned> attempts(n, 0);
+    std::vector<bool> done(n, false), lost(n, false), backed_up(n, false);
+    std::vector<std::unique_ptr<ShardResult>> finished(n);
+    std::vector<double> shard_ms;
+    std::vector<Task> running;
+    std::size_t next_out = 0;
+
+    auto start_task = [&](std::size_t shard) {
+        std::vector<std::string> argv = config.worker_argv;
+        argv.insert(argv.end(), { "--shard-worker", shards[shard].path,
+            std::to_string(shards[shard].begin), std::to_string(shards[shard].end) });
+
+        Task t{ shard, 0, -1, Clock::now(), {}, false };
+        t.pid = launch(argv, t.fd);
+        running.push_back(std::move(t));
+        ++report.launched;
+    };
+
+    auto copies = [&](std::size_t shard) {
+        return std::count_if(running.begin(), running.end(), [&](const Task& t) { return t.shard == shard; });
+    };
+
+    auto stop_copies = [&](std::size_t shard) {
+        for (auto it = running.begin(); it != running.end();) {
+            if (it->shard != shard) {
+                ++it;
+                continue;
+            }
+            ::kill(it->pid, SIGKILL);
+            ::close(it->fd);
+            reap(it->pid);
+            it = running.erase(it);
+        }
+    };
+
+    auto finish_task = [&](Task& t) {
+        // the pipe is closed: collect the exit status and the reply
+        ::close(t.fd);
+        const bool exited = reap(t.pid);
+        if (done[t.shard]) return;
+
+        auto result = std::make_unique<ShardResult>();
+        if (exited && read_shard_result(t.reply, *result)) {
+            done[t.shard] = true;
+            finished[t.shard] = std::move(result);
+            shard_ms.push_back(std::chrono::duration<double, std::milli>(Clock::now() - t.start).count());
+            return;
+        }
+
+        ++report.failed;
+        if (copies(t.shard) > 0) return; // another copy (t is already out of running) is still going
+        if (++attempts[t.shard] < config.max_attempts) {
+            queue.push_back(t.shard);
+        }
+        else {
+            lost[t.shard] = true;
+            report.lost_shards.push_back(t.shard);
+        }
+    };
+
+    while (next_out < n) {
+        const unsigned slots = std::max(1u, config.workers);
+
+        while (running.size() < slots && !queue.empty()) {
+            start_task(queue.front());
+            queue.pop_front();
+        }
+
+        /* Nothing left to hand out: give the slowest straggler a second chance */
+        if (running.size() < slots && queue.empty() && !shard_ms.empty()) {
+            const double limit = config.backup_after * median(shard_ms);
+            for (std::size_t k = 0; k < running.size() && running.size() < slots; ++k) {
+                const Task& t = running[k];
+                const double ms = std::chrono::duration<double, std::milli>(Clock::now() - t.start).count();
+                if (ms > limit && !backed_up[t.shard] && copies(t.shard) == 1) {
+                    backed_up[t.shard] = true;
+                    ++report.backups;
+                    start_task(t.shard);
+                }
+            }
+        }
+
+        if (!running.empty()) {
+            std::vector<pollfd> fds;
+            for (const Task& t : running) fds.push_back(pollfd{ t.fd, POLLIN, 0 });
+            const int ready = ::poll(fds.data(), fds.size(), 100);
+            if (ready < 0 && errno != EINTR) {
+                throw std::runtime_error(std::string("poll failed: ") + std::strerror(errno));
+            }
+
+            std::vector<std::size_t> closed_shards;
+            for (std::size_t k = 0; k < fds.size(); ++k) {
+                if (!(fds[k].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+                char buf[65536];
+                const ssize_t got = ::read(running[k].fd, buf, sizeof(buf));
+                if (got > 0) {
+                    running[k].reply.append(buf, static_cast<std::size_t>(got));
+                }
+                else if (got == 0 || errno != EINTR) {
+                    running[k].eof = true;
+                }
+            }
+
+            /* Finish closed tasks; a finished shard takes its other copies down with it */
+            for (std::size_t k = 0; k < running.size();) {
+                if (!running[k].eof) {
+                    ++k;
+                    continue;
+                }
+                Task t = std::move(running[k]);
+                running.erase(running.begin() + k);
+                finish_task(t);
+                if (done[t.shard]) {
+                    stop_copies(t.shard);
+                    k = 0;
+                }
+            }
+        }
+
+        /* Hand results over in shard order */
+        while (next_out < n && (done[next_out] || lost[next_out])) {
+            if (done[next_out]) {
+                on_result(next_out, *finished[next_out]);
+                finished[next_out].reset();
+            }
+            ++next_out;
+        }
+    }
+
+    std::sort(report.lost_shards.begin(), report.lost_shards.end());
+    return report;
+}
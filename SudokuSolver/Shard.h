@@ -0,0 +1,79 @@
+#pragma once
+
+#include "BatchStats.h"
+#include "PuzzleArchive.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+/*
+Sharded batch runs across worker processes (POSIX only).
+
+An input file is split into shards by byte range; a shard owns every line
+that starts inside its range, so shards can be cut without reading the
+file first. The coordinator starts one worker process per shard, a few at
+a time, and reads each worker's reply from a pipe on its stdout:
+
+    sudoku-shard 1
+    records <n>          followed by n bytes of formatted result records
+    <BatchStats::save() text>
+    puzzles <k>          followed by k lines of "<index> <puzzle>"
+    end
+
+Indices in the reply are local to the shard. The puzzles listed are the
+ones the statistics name (hardest and failed), so the coordinator can
+report on them without reading the inputs itself.
+
+A worker that exits with an error, or whose reply is cut short, has its
+shard queued again, up to max_attempts times. When nothing is left to
+queue, a shard that has been running much longer than the finished ones
+gets a backup copy on a free slot; whichever copy finishes first is used
+and the other is killed.
+*/
+
+struct ShardRange {
+    std::string path;
+    std::uint64_t begin = 0;
+    std::uint64_t end = 0;
+};
+
+// Split a file into up to count byte ranges of about the same size
+std::vector<ShardRange> split_shards(const std::string& path, unsigned count);
+
+// The puzzles on lines that start within the range; throws std::runtime_error if the file can't be read
+PuzzleArchive read_shard(const ShardRange& range);
+
+struct ShardResult {
+    std::string records;                // formatted result records, in input order
+    BatchStats stats;                   // indices local to the shard
+    std::map<int, std::string> puzzles; // the puzzles stats refers to
+};
+
+void write_shard_result(std::ostream& out, const ShardResult& result);
+// False if the reply is malformed or incomplete
+bool read_shard_result(const std::string& data, ShardResult& result);
+
+struct CoordinatorConfig {
+    std::vector<std::string> worker_argv; // each worker runs this plus "--shard-worker <path> <begin> <end>"
+    unsigned workers = 1;                 // worker processes at once
+    unsigned max_attempts = 3;            // failed runs of one shard before giving up on it
+    double backup_after = 3.0;            // back up shards running this many times the median shard time
+};
+
+struct CoordinatorReport {
+    unsigned launched = 0;
+    unsigned failed = 0;   // worker runs that did not return a result
+    unsigned backups = 0;  // extra copies started for slow shards
+    std::vector<std::size_t> lost_shards; // shards that failed every attempt
+};
+
+/*
+Runs every shard and hands each result to on_result in shard order, as
+soon as it and all the shards before it are done. Shards that failed
+every attempt are skipped and listed in the report.
+*/
+CoordinatorReport run_shards(const std::vector<ShardRange>& shards, const CoordinatorConfig& config,
+    const std::function<void(std::size_t, ShardResult&)>& on_result);
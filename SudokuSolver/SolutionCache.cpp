@@ -0,0 +1,94 @@
+
+#include "SolutionCache.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+//===============================================================================
+SolutionCache::SolutionCache(std::size_t capacity, unsigned shards) {
+    shards = std::max(1u, shards);
+    shard_capacity_ = std::max<std::size_t>(1, (capacity + shards - 1) / shards);
+    for (unsigned s = 0; s < shards; ++s) {
+        shards_.push_back(std::make_unique<Shard>());
+    }
+}
+
+//===============================================================================
+SolutionCache::Shard& SolutionCache::shard_for(const std::string& key) {
+    return *shards_[std::hash<std::string>()(key) % shards_.size()];
+}
+
+//===============================================================================
+bool SolutionCache::lookup(const std::string& canonical, std::string& solution) {
+    Shard& s = shard_for(canonical);
+    std::lock_guard<std::mutex> lock(s.mutex);
+
+    auto it = s.index.find(canonical);
+    if (it == s.index.end()) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    s.lru.splice(s.lru.begin(), s.lru, it->second);
+    solution = it->second->second;
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+//===============================================================================
+void SolutionCache::insert(const std::string& canonical, const std::string& solution) {
+    Shard& s = shard_for(canonical);
+    std::lock_guard<std::mutex> lock(s.mutex);
+
+    auto it = s.index.find(canonical);
+    if (it != s.index.end()) {
+        it->second->second = solution;
+        s.lru.splice(s.lru.begin(), s.lru, it->second);
+        return;
+    }
+
+    if (s.lru.size() >= shard_capacity_) {
+        s.index.erase(s.lru.back().first);
+        s.lru.pop_back();
+    }
+
+    s.lru.emplace_front(canonical, solution);
+    s.index.emplace(canonical, s.lru.begin());
+}
+
+//===============================================================================
+std::size_t SolutionCache::size() const {
+    std::size_t n = 0;
+    for (auto& s : shards_) {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        n += s->lru.size();
+    }
+    return n;
+}
+
+//===============================================================================
+sudoku::Result solve_cached(const std::string& grid, SolutionCache& cache, const sudoku::Options& options) {
+    auto start = std::chrono::steady_clock::now();
+
+    CanonicalForm form;
+    if (!canonicalize(grid, form)) {
+        return sudoku::solve(grid, options);
+    }
+
+    std::string solution;
+    if (cache.lookup(form.grid, solution)) {
+        sudoku::Result r;
+        r.status = sudoku::Status::Solved;
+        r.solution = from_canonical(solution, form.transform);
+        r.stats.cache_hit = true;
+        auto end = std::chrono::steady_clock::now();
+        r.stats.elapsed_ms = 1e-3 * std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        return r;
+    }
+
+    sudoku::Result r = sudoku::solve(grid, options);
+    if (r.status == sudoku::Status::Solved) {
+        cache.insert(form.grid, to_canonical(r.solution, form.transform));
+    }
+    return r;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Canonical.h"
+#include "sudoku.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/*
+Bounded, thread-safe cache of solutions keyed by canonical puzzle.
+
+Entries are spread over independently locked shards, each evicting its
+least recently used entry when full, so concurrent lookups rarely contend.
+Solutions are stored in the canonical frame; solve_cached() maps them back
+through the transform of the puzzle that was asked for, so a relabeled,
+permuted or transposed copy of a solved puzzle is answered from the cache.
+*/
+class SolutionCache {
+public:
+    explicit SolutionCache(std::size_t capacity, unsigned shards = 16);
+    SolutionCache(const SolutionCache&) = delete;
+    SolutionCache& operator=(const SolutionCache&) = delete;
+
+    bool lookup(const std::string& canonical, std::string& solution);
+    void insert(const std::string& canonical, const std::string& solution);
+
+    std::size_t size() const;
+    std::uint64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+    std::uint64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+
+private:
+    struct Shard {
+        std::mutex mutex;
+        std::list<std::pair<std::string, std::string>> lru; // most recent first
+        std::unordered_map<std::string, std::list<std::pair<std::string, std::string>>::iterator> index;
+    };
+
+    Shard& shard_for(const std::string& key);
+
+    std::size_t shard_capacity_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<std::uint64_t> hits_{ 0 };
+    std::atomic<std::uint64_t> misses_{ 0 };
+};
+
+// sudoku::solve() that answers equivalent 9x9 puzzles from the cache and stores new solutions
+sudoku::Result solve_cached(const std::string& grid, SolutionCache& cache, const sudoku::Options& options = sudoku::Options());
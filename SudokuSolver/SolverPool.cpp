@@ -0,0 +1,96 @@
+
+#include "SolverPool.h"
+#include <algorithm>
+#include <memory_resource>
+
+//===============================================================================
+SolverPool::SolverPool(unsigned threads, std::size_t queue_capacity, std::size_t max_batch, const sudoku::Options& options, SolutionCache* cache)
+    : capacity_(std::max<std::size_t>(1, queue_capacity)), max_batch_(std::max<std::size_t>(1, max_batch)),
+    num_workers_(std::max(1u, threads)), options_(options), cache_(cache) {
+    for (unsigned t = 0; t < num_workers_; ++t) {
+        workers_.emplace_back(&SolverPool::run, this);
+    }
+}
+
+//===============================================================================
+SolverPool::~SolverPool() {
+    shutdown();
+}
+
+//===============================================================================
+bool SolverPool::submit(std::string puzzle, Callback done) {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this] { return stopping_ || queue_.size() < capacity_; });
+        if (stopping_) return false;
+        queue_.push_back(Job{ std::move(puzzle), std::move(done) });
+    }
+    not_empty_.notify_one();
+    return true;
+}
+
+//===============================================================================
+bool SolverPool::try_submit(std::string puzzle, Callback done) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_ || queue_.size() >= capacity_) return false;
+        queue_.push_back(Job{ std::move(puzzle), std::move(done) });
+    }
+    not_empty_.notify_one();
+    return true;
+}
+
+//===============================================================================
+void SolverPool::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_ && workers_.empty()) return;
+        stopping_ = true;
+    }
+    not_empty_.notify_all();
+    not_full_.notify_all();
+    for (auto& w : workers_) {
+        if (w.joinable()) w.join();
+    }
+    workers_.clear();
+}
+
+//===============================================================================
+std::size_t SolverPool::queue_depth() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.size();
+}
+
+//===============================================================================
+void SolverPool::run() {
+    std::vector<Job> batch;
+    batch.reserve(max_batch_);
+
+    // this worker's own pool for guess stacks and trails, off the shared heap
+    std::pmr::unsynchronized_pool_resource arena;
+    sudoku::Options options = options_;
+    options.memory = &arena;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            not_empty_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) return; // stopping and drained
+
+            // take a fair share of the queue so a short burst still spreads over all workers
+            const std::size_t share = std::max<std::size_t>(1, queue_.size() / num_workers_);
+            const std::size_t n = std::min(max_batch_, share);
+            for (std::size_t i = 0; i < n; ++i) {
+                batch.push_back(std::move(queue_.front()));
+                queue_.pop_front();
+            }
+        }
+        not_full_.notify_all();
+
+        for (auto& job : batch) {
+            const sudoku::Result r = cache_ ? solve_cached(job.puzzle, *cache_, options) : sudoku::solve(job.puzzle, options);
+            if (job.done) job.done(job.puzzle, r);
+        }
+        batch.clear();
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "SolutionCache.h"
+#include "sudoku.h"
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+Fixed set of worker threads solving puzzles from a bounded queue.
+
+Workers take up to max_batch queued puzzles per lock acquisition, so bursts
+of small requests from many clients are solved back to back without a
+wakeup per puzzle. submit() blocks while the queue is full, which pushes
+back on whoever is producing the requests.
+
+The callback runs on the worker thread that solved the puzzle. With a
+cache, 9x9 puzzles equivalent to one solved before are answered from it.
+*/
+class SolverPool {
+public:
+    using Callback = std::function<void(const std::string& puzzle, const sudoku::Result& result)>;
+
+    SolverPool(unsigned threads, std::size_t queue_capacity, std::size_t max_batch = 16,
+        const sudoku::Options& options = sudoku::Options(), SolutionCache* cache = nullptr);
+    SolverPool(const SolverPool&) = delete;
+    SolverPool& operator=(const SolverPool&) = delete;
+    ~SolverPool();
+
+    // Blocks while the queue is full. Returns false once the pool is shutting down.
+    bool submit(std::string puzzle, Callback done);
+
+    // Returns false instead of blocking when the queue is full
+    bool try_submit(std::string puzzle, Callback done);
+
+    // Solve everything already queued, then stop the workers
+    void shutdown();
+
+    std::size_t queue_depth() const;
+    std::size_t capacity() const { return capacity_; }
+
+private:
+    struct Job {
+        std::string puzzle;
+        Callback done;
+    };
+
+    void run();
+
+    const std::size_t capacity_;
+    const std::size_t max_batch_;
+    const unsigned num_workers_;
+    const sudoku::Options options_;
+    SolutionCache* const cache_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    std::deque<Job> queue_;
+    bool stopping_ = false;
+    std::vector<std::thread> workers_;
+};
@@ -1,33 +1,316 @@
 ﻿// SudokuSolver.cpp : Defines the entry point for the application.
 //
 
-#include "Puzzle.h"
+#include "sudoku.h"
+#include "BatchStats.h"
+#include "Checkpoint.h"
+#include "PuzzleArchive.h"
+#include "ResultWriter.h"
+#include "SolutionCache.h"
+#include "TextFormat.h"
+#include "Trace.h"
+#ifndef _WIN32
+#include "Server.h"
+#include "Shard.h"
+#include <csignal>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 #include <sstream>
 #include <iostream>
-#include <filesystem>
 #include <fstream>
 #include <memory>
 #include <assert.h>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <memory_resource>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class StatsLevel { None, Summary, Full };
+
+struct Config {
+    std::vector<std::string> inputs;  // "-" reads stdin
+    sudoku::Options options;
+    unsigned threads = 1;             // 0 uses every core
+    std::string output;
+    StatsLevel stats = StatsLevel::Summary;
+    int max_runs = 10000000;
+    bool max_runs_given = false;      // -n was on the command line
+    std::size_t cache_entries = 0;    // solution cache for repeated/equivalent puzzles
+    bool compare_branching = false;   // solve the inputs once per branching strategy
+    bool scaling = false;             // solve the inputs with 1, 2, 4, ... threads and compare
+    bool pin = false;                 // pin each worker thread to its own core
+    bool minimize = false;            // reduce the inputs to minimal puzzles instead of solving them
+    std::string serve;                // socket path to serve on
+    std::string connect;              // socket path of a server to send the inputs to
+    std::string checkpoint;           // batch progress file, empty for none
+    int checkpoint_every = 50000;     // puzzles solved between checkpoints
+    bool resume = false;              // continue from the checkpoint if there is one
+    std::string trace;                // Chrome trace output file, empty for none
+    std::size_t trace_events = 0;     // events kept per traced thread, 0 for the default
+    unsigned shards = 0;              // split each input into this many shards for worker processes
+    unsigned processes = 0;           // worker processes at once, 0 for one per core
+    bool shard_worker = false;        // solve one shard and send the results to stdout
+    std::string shard_path;
+    std::uint64_t shard_begin = 0;
+    std::uint64_t shard_end = 0;
+    std::string shard_format = "none"; // record format a shard worker sends: csv, jsonl or none
+    std::string program;              // argv[0]
+};
+
+void print_usage(const char* argv0) {
+    std::cout << "Usage: " << argv0 << " [options] [input files...]\n"
+        << "\n"
+        << "Solves every puzzle in the input files (one per line, '#' for comments).\n"
+        << "Use '-' to read from stdin. Without inputs the bundled archives in the\n"
+        << "current directory are solved.\n"
+        << "\n"
+        << "Options:\n"
+        << "  -e, --engine NAME    rules (default), recurse or lanes\n"
+        << "  -j, --threads N      worker threads, 0 for one per core (default 1)\n"
+        << "  -o, --output FILE    write each result as CSV, or JSON lines for .json/.jsonl\n"
+        << "  -u, --undo MODE      snapshot (default) or trail: how guesses are taken back\n"
+        << "  -r, --rules SET      singles, subsets or full (default): rules run before guessing\n"
+        << "  -b, --branching NAME mrv (default), unit, degree or freq; all to compare them\n"
+        << "  -p, --parallel N     search each puzzle with N threads (rules engine)\n"
+        << "  -t, --timeout MS     give up on a puzzle after MS milliseconds\n"
+        << "  -s, --stats LEVEL    none, summary (default) or full\n"
+        << "  -n, --max-runs N     solve at most N puzzles\n"
+        << "  -c, --cache N        answer repeated or equivalent puzzles from an N entry cache\n"
+        << "      --pin            pin each worker thread to its own core\n"
+        << "      --minimize       remove redundant clues; -o FILE gets one minimal puzzle per input\n"
+        << "      --scaling        solve the inputs with 1, 2, 4, ... up to -j or all cores and compare\n"
+        << "      --checkpoint FILE save batch progress to FILE every --checkpoint-every puzzles\n"
+        << "      --checkpoint-every N  puzzles between checkpoints (default 50000)\n"
+        << "      --resume         continue the batch from its checkpoint file\n"
+        << "      --trace FILE     write a Chrome trace of the solver threads (needs -DSUDOKU_TRACE=ON)\n"
+        << "      --trace-events N keep at most N recent events per traced thread (default 65536)\n"
+        << "      --serve PATH     run as a solver service on a Unix socket (uses -j, -e, -t, -c)\n"
+        << "      --connect PATH   send the input puzzles to a running service and print the replies\n"
+        << "      --shards N       split each input file into N shards solved by worker processes (not with -n)\n"
+        << "      --processes N    worker processes at once for --shards, 0 for one per core (default)\n"
+        << "  -h, --help           show this message\n";
+}
 
+bool parse_args(int argc, char* argv[], Config& cfg) {
+    /*
+    Returns false (after printing why) if the arguments are invalid or
+    only help was requested
+    */
+    cfg.program = argv[0];
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+
+        auto value = [&](std::string& out) {
+            if (i + 1 >= argc) {
+                std::cout << "Missing value for " << arg << std::endl;
+                return false;
+            }
+            out = argv[++i];
+            return true;
+        };
+
+        std::string v;
+        if (arg == "-h" || arg == "--help") {
+            print_usage(argv[0]);
+            return false;
+        }
+        else if (arg == "-e" || arg == "--engine") {
+            if (!value(v)) return false;
+            if (v == "rules") cfg.options.engine = sudoku::Engine::Rules;
+            else if (v == "recurse") cfg.options.engine = sudoku::Engine::Recurse;
+            else if (v == "lanes") cfg.options.engine = sudoku::Engine::Lanes;
+            else {
+                std::cout << "Unknown engine " << v << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "-j" || arg == "--threads") {
+            if (!value(v)) return false;
+            cfg.threads = static_cast<unsigned>(std::atoi(v.c_str()));
+        }
+        else if (arg == "-o" || arg == "--output") {
+            if (!value(cfg.output)) return false;
+        }
+        else if (arg == "-u" || arg == "--undo") {
+            if (!value(v)) return false;
+            if (v == "snapshot") cfg.options.undo = sudoku::Undo::Snapshot;
+            else if (v == "trail") cfg.options.undo = sudoku::Undo::Trail;
+            else {
+                std::cout << "Unknown undo mode " << v << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "-r" || arg == "--rules") {
+            if (!value(v)) return false;
+            if (v == "singles") cfg.options.rules = sudoku::RuleSet::Singles;
+            else if (v == "subsets") cfg.options.rules = sudoku::RuleSet::Subsets;
+            else if (v == "full") cfg.options.rules = sudoku::RuleSet::Full;
+            else {
+                std::cout << "Unknown rule set " << v << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "-b" || arg == "--branching") {
+            if (!value(v)) return false;
+            if (v == "mrv") cfg.options.branching = sudoku::Branching::Mrv;
+            else if (v == "unit") cfg.options.branching = sudoku::Branching::UnitDigit;
+            else if (v == "degree") cfg.options.branching = sudoku::Branching::Degree;
+            else if (v == "freq") cfg.options.branching = sudoku::Branching::Frequency;
+            else if (v == "all") cfg.compare_branching = true;
+            else {
+                std::cout << "Unknown branching strategy " << v << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "-p" || arg == "--parallel") {
+            if (!value(v)) return false;
+            cfg.options.threads = std::max(1, std::atoi(v.c_str()));
+        }
+        else if (arg == "-t" || arg == "--timeout") {
+            if (!value(v)) return false;
+            cfg.options.timeout_ms = std::atof(v.c_str());
+        }
+        else if (arg == "-s" || arg == "--stats") {
+            if (!value(v)) return false;
+            if (v == "none") cfg.stats = StatsLevel::None;
+            else if (v == "summary") cfg.stats = StatsLevel::Summary;
+            else if (v == "full") cfg.stats = StatsLevel::Full;
+            else {
+                std::cout << "Unknown stats level " << v << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "-n" || arg == "--max-runs") {
+            if (!value(v)) return false;
+            cfg.max_runs = std::atoi(v.c_str());
+            cfg.max_runs_given = true;
+        }
+        else if (arg == "-c" || arg == "--cache") {
+            if (!value(v)) return false;
+            cfg.cache_entries = static_cast<std::size_t>(std::atoll(v.c_str()));
+        }
+        else if (arg == "--minimize") {
+            cfg.minimize = true;
+        }
+        else if (arg == "--pin") {
+            cfg.pin = true;
+        }
+        else if (arg == "--scaling") {
+            cfg.scaling = true;
+        }
+        else if (arg == "--checkpoint") {
+            if (!value(cfg.checkpoint)) return false;
+        }
+        else if (arg == "--checkpoint-every") {
+            if (!value(v)) return false;
+            cfg.checkpoint_every = std::max(1, std::atoi(v.c_str()));
+        }
+        else if (arg == "--resume") {
+            cfg.resume = true;
+        }
+        else if (arg == "--trace") {
+            if (!value(cfg.trace)) return false;
+            if (!trace::compiled_in) {
+                std::cout << "--trace needs a build configured with -DSUDOKU_TRACE=ON" << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--trace-events") {
+            if (!value(v)) return false;
+            cfg.trace_events = static_cast<std::size_t>(std::max(0ll, std::atoll(v.c_str())));
+        }
+        else if (arg == "--shards") {
+            if (!value(v)) return false;
+            cfg.shards = static_cast<unsigned>(std::max(0, std::atoi(v.c_str())));
+        }
+        else if (arg == "--processes") {
+            if (!value(v)) return false;
+            cfg.processes = static_cast<unsigned>(std::max(0, std::atoi(v.c_str())));
+        }
+        else if (arg == "--shard-worker") {
+            // internal: path, begin and end of the byte range, sent by a --shards coordinator
+            std::string begin, end;
+            if (!value(cfg.shard_path) || !value(begin) || !value(end)) return false;
+            cfg.shard_worker = true;
+            cfg.shard_begin = std::strtoull(begin.c_str(), nullptr, 10);
+            cfg.shard_end = std::strtoull(end.c_str(), nullptr, 10);
+        }
+        else if (arg == "--shard-format") {
+            if (!value(cfg.shard_format)) return false;
+        }
+        else if (arg == "--serve") {
+            if (!value(cfg.serve)) return false;
+        }
+        else if (arg == "--connect") {
+            if (!value(cfg.connect)) return false;
+        }
+        else if (arg.size() > 1 && arg[0] == '-') {
+            std::cout << "Unknown option " << arg << std::endl;
+            print_usage(argv[0]);
+            return false;
+        }
+        else if (i == 1 && !arg.empty() && std::all_of(arg.begin(), arg.end(), [](char c) { return c >= '0' && c <= '9'; })
+            && !std::ifstream(arg)) {
+            // the original command line: a leading bare number is the run limit
+            cfg.max_runs = std::atoi(arg.c_str());
+            cfg.max_runs_given = true;
+        }
+        else {
+            cfg.inputs.push_back(arg);
+        }
+    }
 
-std::vector<std::unique_ptr<Puzzle>> read_puzzles() {
+    if (cfg.resume && cfg.checkpoint.empty()) {
+        std::cout << "--resume needs --checkpoint" << std::endl;
+        return false;
+    }
+    if (cfg.shards > 0 && cfg.max_runs_given) {
+        // shards are byte ranges of whole files, so there is no puzzle count to stop at
+        std::cout << "--shards solves whole input files and can't be combined with -n" << std::endl;
+        return false;
+    }
 
-    std::vector<std::string> files = { "puzzles6_forum_hardest_1106", "puzzles2_17_clue","puzzles3_magictour_top1465" };
+    if (cfg.threads == 0) {
+        cfg.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (cfg.processes == 0) {
+        cfg.processes = std::max(1u, std::thread::hardware_concurrency());
+    }
 
-    std::vector<std::unique_ptr<Puzzle>> p;
+    return true;
+}
+
+void read_stream(std::istream& in, PuzzleArchive& p) {
+    std::string line;
+    while (std::getline(in, line)) {
+        p.add_line(line);
+    }
+}
+
+PuzzleArchive read_puzzles(const std::vector<std::string>& files) {
+
+    PuzzleArchive p;
 
     for (auto&& f : files) {
+        if (f == "-") {
+            read_stream(std::cin, p);
+            continue;
+        }
+
         std::ifstream pfile(f);
         if (pfile.is_open()) {
-            std::string line;
-            while (std::getline(pfile, line)) {
-                if (line.rfind("#", 0) == 0) continue;
-
-                if (line.size() == 81) {
-                    p.emplace_back(std::make_unique<Puzzle>(line));
-                }
-            }
+            read_stream(pfile, p);
             pfile.close();
         }
         else {
@@ -35,129 +318,682 @@ std::vector<std::unique_ptr<Puzzle>> read_puzzles() {
         }
     }
 
-    std::cout << "Read " << p.size() << " puzzles" << std::endl;
-
     return p;
 }
 
-bool test_archive(int max_runs) {
-    auto puzzles = read_puzzles();
+void report(OutputBuffer& out, const std::string& puzzle, const sudoku::Result& r) {
+    if (r.status == sudoku::Status::Solved) {
+        out << "Solved " << puzzle << " in ";
+        char* p = out.reserve(64);
+        p = format_ms(p, r.stats.elapsed_ms);
+        p = std::copy_n(" ms with ", 9, p);
+        p = format_uint(p, r.stats.guesses);
+        out.commit(p);
+        out << " guesses\n";
+    }
+    else {
+        out << "Failed to solve " << puzzle << " (" << sudoku::status_name(r.status) << ")\n";
+    }
+}
+
+void pin_to_core(unsigned t) {
+    // the t-th of the cores this process may run on, wrapping around
+#ifdef __linux__
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return;
+    const int count = CPU_COUNT(&allowed);
+    if (count == 0) return;
+
+    int skip = static_cast<int>(t % count);
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &allowed) || skip-- > 0) continue;
+        cpu_set_t one;
+        CPU_ZERO(&one);
+        CPU_SET(cpu, &one);
+        pthread_setaffinity_np(pthread_self(), sizeof(one), &one);
+        return;
+    }
+#else
+    (void)t;
+#endif
+}
+
+BatchStats solve_all(const Config& cfg, const PuzzleArchive& puzzles, int first, int last, SolutionCache* cache,
+    const std::function<void(int, sudoku::Result&)>& on_result, double& wall_ms) {
+    /*
+    Solve puzzles first..last-1 on cfg.threads workers. Each worker
+    aggregates into its own BatchStats, merged at the end; on_result sees
+    each result on the worker thread that produced it
+    */
+    std::vector<BatchStats> partial(std::max(1u, cfg.threads));
+
+    // workers pull the next puzzle index (or, for the lanes engine, block of puzzles) from a shared counter
+    const bool lanes = cfg.options.engine == sudoku::Engine::Lanes;
+    const int block = lanes ? 64 : 1;
+    std::atomic<int> next{ first };
+
+    auto worker = [&](unsigned t) {
+        if (trace::enabled()) trace::set_thread_name("worker " + std::to_string(t));
+        if (cfg.pin) pin_to_core(t);
+
+        /*
+        Guess stacks and trails come from a pool owned by this worker: no
+        heap lock shared with the other workers, blocks are reused from one
+        puzzle to the next, and its pages are first touched (so placed) by
+        the thread that uses them
+        */
+        std::pmr::unsynchronized_pool_resource arena;
+        sudoku::Options options = cfg.options;
+        options.memory = &arena;
+        std::string grid;
+
+        BatchStats local;
+        auto record = [&](int i, sudoku::Result& r) {
+            local.add(i, r);
+            if (on_result) on_result(i, r);
+        };
+
+        for (int i = next.fetch_add(block); i < last; i = next.fetch_add(block)) {
+            if (lanes) {
+                const int end = std::min(last, i + block);
+                std::vector<std::string> grids;
+                for (int k = i; k < end; ++k) grids.push_back(puzzles[k]);
+                auto rs = sudoku::solve_batch(grids, options);
+                for (int k = i; k < end; ++k) record(k, rs[k - i]);
+                continue;
+            }
+
+            grid = puzzles[i];
+            sudoku::Result r = cache ? solve_cached(grid, *cache, options) : sudoku::solve(grid, options);
+            record(i, r);
+        }
+        partial[t] = std::move(local);
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    // with pinning every worker gets a thread of its own, so the calling thread is not left pinned
+    const unsigned own = cfg.pin ? 0 : 1;
+    std::vector<std::thread> threads;
+    for (unsigned t = own; t < partial.size(); ++t) threads.emplace_back(worker, t);
+    if (own) worker(0);
+    for (auto& t : threads) t.join();
+    auto end = std::chrono::steady_clock::now();
+    wall_ms = 1e-3 * std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+    BatchStats stats = std::move(partial[0]);
+    for (std::size_t t = 1; t < partial.size(); ++t) stats.merge(partial[t]);
+    return stats;
+}
 
+bool compare_branching(const Config& cfg, PuzzleArchive puzzles) {
     if (puzzles.empty()) return false;
 
-    max_runs = std::min(max_runs, (int)puzzles.size());
+    const int max_runs = std::min(cfg.max_runs, (int)puzzles.size());
+    puzzles.resize(max_runs);
+    std::cout << "Comparing branching strategies on " << max_runs << " puzzles" << std::endl;
 
-    for (int i = 0; i < max_runs; ++i) {
-        puzzles[i]->solve();
-        if (!puzzles[i]->solved()) {
-            max_runs = i+1;
-            break;
-        }
+    bool ok = true;
+    for (auto b : { sudoku::Branching::Mrv, sudoku::Branching::UnitDigit, sudoku::Branching::Degree, sudoku::Branching::Frequency }) {
+        Config c = cfg;
+        c.options.branching = b;
+
+        double wall_ms = 0.0;
+        const BatchStats stats = solve_all(c, puzzles, 0, max_runs, nullptr, nullptr, wall_ms);
+        ok &= stats.failures.empty();
+
+        std::cout << "  " << sudoku::branching_name(b) << ": avg guesses " << stats.total_guesses / max_runs
+            << ", max guesses " << stats.max_guesses << ", avg time " << stats.total_time / max_runs
+            << " ms, max time " << stats.max_time << " ms, failed " << stats.failures.size() << std::endl;
     }
+    return ok;
+}
 
+bool scaling_curve(const Config& cfg, PuzzleArchive puzzles) {
+    /*
+    The same batch with 1, 2, 4, ... worker threads up to -j (or every core
+    when -j is 1), then the top count itself if it is not a power of two
+    */
+    if (puzzles.empty()) return false;
 
+    const int max_runs = std::min(cfg.max_runs, (int)puzzles.size());
+    puzzles.resize(max_runs);
+
+    const unsigned top = cfg.threads > 1 ? cfg.threads : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> counts;
+    for (unsigned n = 1; n < top; n *= 2) counts.push_back(n);
+    counts.push_back(top);
+
+    std::cout << "Scaling on " << max_runs << " puzzles" << (cfg.pin ? ", pinned threads" : "") << std::endl;
+    std::cout << "  threads    wall ms  puzzles/s  speedup  efficiency" << std::endl;
+
+    bool ok = true;
+    double base_ms = 0.0;
+    for (unsigned n : counts) {
+        Config c = cfg;
+        c.threads = n;
+
+        double wall_ms = 0.0;
+        const BatchStats stats = solve_all(c, puzzles, 0, max_runs, nullptr, nullptr, wall_ms);
+        ok &= stats.failures.empty();
+        if (n == 1) base_ms = wall_ms;
+
+        const double speedup = wall_ms > 0.0 ? base_ms / wall_ms : 0.0;
+        std::cout << std::fixed << std::setprecision(1)
+            << "  " << std::setw(7) << n << std::setw(11) << wall_ms
+            << std::setw(11) << (wall_ms > 0.0 ? 1e3 * max_runs / wall_ms : 0.0)
+            << std::setprecision(2) << std::setw(9) << speedup
+            << std::setprecision(0) << std::setw(11) << 100.0 * speedup / n << "%" << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+        std::cout << std::setprecision(6);
+    }
+    return ok;
+}
 
-    double avg_time = 0.0;
-    double avg_guesses = 0.0;
-    int num_errs = 0;
-    int no_guess_solves = 0;
-    int max_guesses = 0;
-    double min_time = 1e12;
-    double max_time = 0.0;
+bool minimize_all(const Config& cfg, PuzzleArchive puzzles) {
+    /*
+    One puzzle per worker at a time, its clue trials on that worker: for
+    whole archives that keeps every thread busy without the per-puzzle
+    thread start-up
+    */
+    if (puzzles.empty()) return false;
 
-    for (int i = 0; i < max_runs; ++i) {
-        if (puzzles[i]->solved()) {
-            avg_time += puzzles[i]->elapsed_time();
-            avg_guesses += puzzles[i]->num_guesses();
+    const int max_runs = std::min(cfg.max_runs, (int)puzzles.size());
+    puzzles.resize(max_runs);
 
-            if (puzzles[i]->num_guesses() == 0) ++no_guess_solves;
-            max_guesses = std::max(max_guesses, puzzles[i]->num_guesses());
+    std::vector<std::string> minimal(max_runs);
+    std::vector<char> unique(max_runs, 0);
+    std::atomic<int> next{ 0 };
 
-            min_time = std::min(min_time, puzzles[i]->elapsed_time());
-            max_time = std::max(max_time, puzzles[i]->elapsed_time());
+    auto worker = [&](unsigned t) {
+        if (cfg.pin) pin_to_core(t);
+        for (int i = next++; i < max_runs; i = next++) {
+            const std::string grid = puzzles[i];
+            unique[i] = sudoku::count_solutions(grid, 2) == 1;
+            minimal[i] = unique[i] ? sudoku::minimize(grid) : grid;
         }
-        else {
-            ++num_errs;
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < std::max(1u, cfg.threads); ++t) threads.emplace_back(worker, t);
+    worker(0);
+    for (auto& t : threads) t.join();
+    auto end = std::chrono::steady_clock::now();
+    const double wall_ms = 1e-3 * std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+    int not_unique = 0, reduced = 0;
+    std::size_t removed = 0;
+    OutputBuffer out(std::cout);
+    for (int i = 0; i < max_runs; ++i) {
+        if (!unique[i]) {
+            ++not_unique;
+            continue;
+        }
+        const std::string grid = puzzles[i];
+        if (minimal[i] == grid) continue;
+
+        ++reduced;
+        for (std::size_t c = 0; c < grid.size(); ++c) removed += grid[c] != minimal[i][c];
+        if (cfg.stats == StatsLevel::Full) out << grid << " -> " << minimal[i] << "\n";
+    }
+    out.flush();
+
+    if (!cfg.output.empty()) {
+        std::ofstream file(cfg.output, std::ios::binary);
+        for (const auto& m : minimal) file << m << '\n';
+        file.flush();
+        if (!file) {
+            std::cout << "COULD NOT WRITE " << cfg.output << std::endl;
+            return false;
         }
     }
-    avg_time /= max_runs;
-    avg_guesses /= max_runs;
 
+    if (cfg.stats != StatsLevel::None) {
+        std::cout << "Checked " << max_runs << " puzzles in " << wall_ms << " ms (" << 1e3 * max_runs / wall_ms
+            << " puzzles/s): " << max_runs - not_unique - reduced << " minimal, " << reduced << " reduced by "
+            << removed << " clues, " << not_unique << " without a unique solution" << std::endl;
+    }
+    return true;
+}
 
+struct RunSummary {
+    double wall_ms = 0.0;
+    int solved_now = 0;                  // puzzles solved by this run, for the throughput
+    std::string workers;                 // what the wall time was spent on, e.g. "4 threads"
+    std::vector<std::string> notes;      // extra summary lines
+    std::vector<std::string> full_notes; // extra lines for -s full
+};
+
+bool print_summary(const Config& cfg, const BatchStats& stats, int count, const RunSummary& run,
+    const std::function<std::string(int)>& puzzle_at) {
+    /*
+    Report on a finished batch; puzzle_at looks up the puzzles the
+    statistics refer to by index. Returns false if any puzzle failed
+    */
+    const int num_errs = static_cast<int>(stats.failures.size());
+    if (cfg.stats == StatsLevel::None) return num_errs == 0;
+
+    std::cout << "Solved " << count << " puzzles, average time = " << stats.total_time / count
+        << " ms, avg guesses = " << stats.total_guesses / count << std::endl;
+
+    std::cout << "  No-guess solves: " << stats.no_guess_solves << " max guesses: " << stats.max_guesses << std::endl;
+    std::cout << "  Min time " << stats.min_time << " ms, max time " << stats.max_time << " ms" << std::endl;
+    std::cout << "  Wall time " << run.wall_ms << " ms on " << run.workers << " ("
+        << (run.wall_ms > 0 ? 1e3 * run.solved_now / run.wall_ms : 0.0) << " puzzles/s)" << std::endl;
+    for (const auto& note : run.notes) std::cout << "  " << note << std::endl;
+
+    if (cfg.stats == StatsLevel::Full) {
+        std::cout << "  Undo traffic " << stats.total_undo_bytes / count << " bytes per puzzle" << std::endl;
+        for (const auto& note : run.full_notes) std::cout << "  " << note << std::endl;
+        for (unsigned r = 0; r < sudoku::num_rules; ++r) {
+            std::cout << "  Rule " << r + 1 << " ratio = " << stats.totals.rule_applies[r] << "/" << stats.totals.rule_calls[r] << std::endl;
+        }
+    }
 
-    std::cout << "Solved " << max_runs << " puzzles, average time = " << avg_time << " ms, avg guesses = " << avg_guesses << std::endl;
+    std::cout << "10 hardest puzzles by guess count" << std::endl;
+    for (const auto& e : stats.by_guesses.sorted()) {
+        std::cout << puzzle_at(e.index) << ": " << e.key << " guesses" << std::endl;
+    }
 
-    std::cout << "  No-guess solves: " << no_guess_solves << " max guesses: " << max_guesses << std::endl;
-    std::cout << "  Min time " << min_time << " ms, max time " << max_time << " ms" << std::endl;
+    std::cout << "10 hardest puzzles by solve time" << std::endl;
+    for (const auto& e : stats.by_time.sorted()) {
+        std::cout << puzzle_at(e.index) << ": " << e.key << " ms" << std::endl;
+    }
 
-    // sort by num guesses
-    std::sort(puzzles.begin(), puzzles.end(), [](const auto& lhs, const auto& rhs) {
-        return lhs->num_guesses() > rhs->num_guesses();
-        });
+    if (num_errs > 0) {
+        OutputBuffer out(std::cout);
+        out << "FAILED to solve " << std::to_string(num_errs) << " puzzles:\n";
+        for (const auto& f : stats.failures) {
+            out << puzzle_at(f.index) << " (" << sudoku::status_name(f.status) << ")\n";
+        }
+    }
 
-    std::cout << "10 hardest puzzles by guess count" << std::endl;
-    for (int i = 0; i < 10; ++i) {
-        std::cout << puzzles[i]->initial_state() << ": " << puzzles[i]->num_guesses() << " guesses" << std::endl;
+    return num_errs == 0;
+}
+
+bool run_batch(const Config& cfg, PuzzleArchive puzzles) {
+    if (puzzles.empty()) return false;
+    if (cfg.compare_branching) return compare_branching(cfg, std::move(puzzles));
+    if (cfg.scaling) return scaling_curve(cfg, std::move(puzzles));
+    if (cfg.minimize) return minimize_all(cfg, std::move(puzzles));
+
+    if (cfg.stats != StatsLevel::None) {
+        std::cout << "Read " << puzzles.size() << " puzzles" << std::endl;
     }
 
-    // sort by time
-    std::sort(puzzles.begin(), puzzles.end(), [](const auto& lhs, const auto& rhs) {
-        return lhs->elapsed_time() > rhs->elapsed_time();
-        });
+    const int max_runs = std::min(cfg.max_runs, (int)puzzles.size());
+    puzzles.resize(max_runs);
+
+    Checkpoint cp;
+    cp.num_puzzles = max_runs;
+    cp.fingerprint = batch_fingerprint(puzzles);
+    if (cfg.resume) {
+        Checkpoint saved;
+        try {
+            if (load_checkpoint(cfg.checkpoint, saved)) {
+                if (saved.num_puzzles != cp.num_puzzles || saved.fingerprint != cp.fingerprint) {
+                    std::cout << "Checkpoint " << cfg.checkpoint << " is for a different batch" << std::endl;
+                    return false;
+                }
+                cp = std::move(saved);
+                std::cout << "Resuming at puzzle " << cp.next_index << " of " << max_runs << std::endl;
+            }
+        }
+        catch (std::exception& e) {
+            std::cout << e.what() << std::endl;
+            return false;
+        }
+    }
+    const int start = static_cast<int>(cp.next_index);
 
-    std::cout << "10 hardest puzzles by solve time" << std::endl;
-    for (int i = 0; i < 10; ++i) {
-        std::cout << puzzles[i]->initial_state() << ": " << puzzles[i]->elapsed_time() << " ms" << std::endl;
+    std::unique_ptr<ResultWriter> writer;
+    if (!cfg.output.empty()) {
+        try {
+            writer = std::make_unique<ResultWriter>(cfg.output, ResultWriter::format_for(cfg.output),
+                ResultWriter::default_flush_bytes, cp.output_bytes);
+        }
+        catch (std::exception& e) {
+            std::cout << e.what() << std::endl;
+            return false;
+        }
     }
 
+    std::unique_ptr<SolutionCache> cache;
+    if (cfg.cache_entries > 0) {
+        cache = std::make_unique<SolutionCache>(cfg.cache_entries);
+    }
 
-    if (num_errs > 0) {
-        std::cout << "FAILED to solve " << num_errs << " puzzles:" << std::endl;
-        for (int i = 0; i < max_runs; ++i) {
-            if (!puzzles[i]->solved()) {
-                std::cout << puzzles[i]->initial_state() << std::endl;
+    // the per-puzzle results are only kept when the full report needs them
+    const bool keep_results = cfg.stats == StatsLevel::Full;
+    ResultTable results(keep_results ? max_runs : 0);
+
+    auto on_result = [&](int i, sudoku::Result& r) {
+        if (writer) writer->write(puzzles[i], r);
+        if (keep_results) results.set(i, r);
+    };
+
+    /*
+    With a checkpoint file the batch is solved in chunks, and after each
+    one the results are fsync'd to disk before the checkpoint says so
+    */
+    const int chunk = cfg.checkpoint.empty() ? max_runs : cfg.checkpoint_every;
+    BatchStats stats = std::move(cp.stats);
+    double wall_ms = 0.0;
+    for (int first = start; first < max_runs; first += chunk) {
+        const int last = std::min(max_runs, first + chunk);
+        double chunk_ms = 0.0;
+        stats.merge(solve_all(cfg, puzzles, first, last, cache.get(), on_result, chunk_ms));
+        wall_ms += chunk_ms;
+
+        if (!cfg.checkpoint.empty()) {
+            cp.next_index = last;
+            cp.stats = stats;
+            try {
+                cp.output_bytes = writer ? writer->sync() : 0;
+                save_checkpoint(cfg.checkpoint, cp);
+            }
+            catch (std::exception& e) {
+                // stop here: carrying on would leave nothing to resume from
+                std::cout << e.what() << std::endl;
+                return false;
             }
         }
     }
 
-    return true;
+    const bool written = !writer || writer->close();
+    if (!written) std::cout << "Could not write result file " << cfg.output << std::endl;
+
+    if (keep_results) {
+        OutputBuffer out(std::cout);
+        for (int i = start; i < max_runs; ++i) report(out, puzzles[i], results.get(i));
+    }
+
+    RunSummary run;
+    run.wall_ms = wall_ms;
+    run.solved_now = max_runs - start;
+    run.workers = std::to_string(std::max(1u, cfg.threads)) + " threads";
+    if (cache) {
+        run.notes.push_back("Cache hits " + std::to_string(cache->hits()) + ", misses " + std::to_string(cache->misses()));
+    }
+    run.full_notes.push_back("Puzzle records " + std::to_string(puzzles.memory_bytes()) + " bytes, results table "
+        + std::to_string(results.memory_bytes()) + " bytes");
+
+    const bool ok = print_summary(cfg, stats, max_runs, run, [&](int i) { return puzzles[i]; });
+    return ok && written;
 }
 
-void spot_test(const std::vector<std::string>& pl) {
-    std::vector<std::unique_ptr<Puzzle>> pv;
-    for (auto&& p : pl) {
-        pv.push_back(std::make_unique<Puzzle>(p));
+#ifndef _WIN32
+volatile std::sig_atomic_t stop_requested = 0;
+
+void request_stop(int) {
+    stop_requested = 1;
+}
+
+int run_server(const Config& cfg) {
+    ServerConfig sc;
+    sc.threads = cfg.threads;
+    sc.options = cfg.options;
+    sc.cache_entries = cfg.cache_entries;
+
+    Server server(cfg.serve, sc);
+    try {
+        server.start();
+    }
+    catch (std::exception& e) {
+        std::cout << e.what() << std::endl;
+        return 1;
     }
-    
-    for (int i = 0; i < (int)pv.size(); ++i) {
-        //std::cout << pv[i]->to_string() << std::endl;
-        pv[i]->solve();
+
+    std::signal(SIGINT, request_stop);
+    std::signal(SIGTERM, request_stop);
+    std::cout << "Serving on " << cfg.serve << " with " << cfg.threads << " threads" << std::endl;
+
+    while (!stop_requested) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
     }
 
-    //std::cout << "SUMMARY" << std::endl;
-    //for (int i = 0; i < (int)pv.size(); ++i) {
-    //    pv[i]->summarize();
-    //}
+    server.stop();
+    std::cout << server.stats_json() << std::endl;
+    return 0;
 }
 
+std::string self_path(const Config& cfg) {
+#ifdef __linux__
+    char buf[4096];
+    const ssize_t n = ::readlink("/proc/self/exe", buf, sizeof(buf));
+    if (n > 0 && n < (ssize_t)sizeof(buf)) return std::string(buf, n);
+#endif
+    return cfg.program;
+}
 
+std::vector<std::string> worker_command(const Config& cfg) {
+    // the solver settings of this run, for a worker process to solve its shard with
+    const sudoku::Options& o = cfg.options;
+    const char* engine = o.engine == sudoku::Engine::Recurse ? "recurse" : o.engine == sudoku::Engine::Lanes ? "lanes" : "rules";
+    const char* undo = o.undo == sudoku::Undo::Trail ? "trail" : "snapshot";
+    const char* rules = o.rules == sudoku::RuleSet::Singles ? "singles" : o.rules == sudoku::RuleSet::Subsets ? "subsets" : "full";
 
-int main(int argc, char* argv[])
-{
-    int max_runs = 10000000;
-    if (argc == 2) {
-        max_runs = std::atoi(argv[1]);
+    std::string format = "none";
+    if (!cfg.output.empty()) {
+        format = ResultWriter::format_for(cfg.output) == ResultWriter::Format::Jsonl ? "jsonl" : "csv";
+    }
+
+    std::vector<std::string> argv = { self_path(cfg), "-e", engine, "-u", undo, "-r", rules,
+        "-b", sudoku::branching_name(o.branching), "-j", std::to_string(cfg.threads),
+        "-p", std::to_string(o.threads), "-t", std::to_string(o.timeout_ms), "--shard-format", format };
+    if (cfg.cache_entries > 0) {
+        argv.push_back("-c");
+        argv.push_back(std::to_string(cfg.cache_entries));
+    }
+    if (cfg.pin) argv.push_back("--pin");
+    return argv;
+}
+
+int run_shard_worker(const Config& cfg) {
+    /*
+    Solve the puzzles of one shard and send the records, statistics and
+    the puzzles they name to stdout, which is the coordinator's pipe
+    */
+    ShardResult out;
+    try {
+        const PuzzleArchive puzzles = read_shard(ShardRange{ cfg.shard_path, cfg.shard_begin, cfg.shard_end });
+        const int count = static_cast<int>(puzzles.size());
+
+        const bool keep_records = cfg.shard_format != "none";
+        const auto format = cfg.shard_format == "jsonl" ? ResultWriter::Format::Jsonl : ResultWriter::Format::Csv;
+        std::vector<std::string> records(keep_records ? count : 0);
+
+        std::unique_ptr<SolutionCache> cache;
+        if (cfg.cache_entries > 0) cache = std::make_unique<SolutionCache>(cfg.cache_entries);
+
+        double wall_ms = 0.0;
+        out.stats = solve_all(cfg, puzzles, 0, count, cache.get(), [&](int i, sudoku::Result& r) {
+            if (keep_records) ResultWriter::format_record(records[i], format, puzzles[i], r);
+            }, wall_ms);
+
+        for (const auto& r : records) out.records += r;
+        for (const auto& e : out.stats.by_guesses.sorted()) out.puzzles[e.index] = puzzles[e.index];
+        for (const auto& e : out.stats.by_time.sorted()) out.puzzles[e.index] = puzzles[e.index];
+        for (const auto& f : out.stats.failures) out.puzzles[f.index] = puzzles[f.index];
+    }
+    catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    write_shard_result(std::cout, out);
+    std::cout.flush();
+    return std::cout ? 0 : 1;
+}
+
+int run_sharded(const Config& cfg) {
+    std::vector<std::string> inputs = cfg.inputs;
+    if (inputs.empty()) inputs = { "puzzles6_forum_hardest_1106", "puzzles2_17_clue", "puzzles3_magictour_top1465" };
+
+    std::vector<ShardRange> shards;
+    for (const auto& f : inputs) {
+        if (f == "-") {
+            std::cout << "--shards needs input files, not stdin" << std::endl;
+            return 1;
+        }
+        try {
+            const auto s = split_shards(f, cfg.shards);
+            shards.insert(shards.end(), s.begin(), s.end());
+        }
+        catch (std::exception& e) {
+            std::cout << e.what() << std::endl;
+        }
+    }
+
+    std::unique_ptr<ResultWriter> writer;
+    if (!cfg.output.empty()) {
+        try {
+            writer = std::make_unique<ResultWriter>(cfg.output, ResultWriter::format_for(cfg.output));
+        }
+        catch (std::exception& e) {
+            std::cout << e.what() << std::endl;
+            return 1;
+        }
     }
 
-    if (!test_archive(max_runs)) {
-        spot_test({
-            "1.......2..34...5..6....7.....85..9....3.6.....8.9.....2....1..7.......6..9.8..3.",
-            "........8..3...4...9..2..6.....79.......612...6.5.2.7...8...5...1.....2.4.5.....3",
-            "........2..8.1.9..5....3.4....1.93...6..3..8...37......4......53.1.7.8..2........",
-            "..2...7...1.....6.5......18....37.......49.....41.23....3.2.9...8.....5.6.......2",
-            "........7..4.2.6..8.....31......29...4..9..3...95.6....1......8..6.5.2..7......6."
+    CoordinatorConfig cc;
+    cc.worker_argv = worker_command(cfg);
+    cc.workers = cfg.processes;
+
+    // shard results arrive in order; their indices move up by the puzzles of the shards before them
+    BatchStats stats;
+    std::map<int, std::string> named;
+    int offset = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    CoordinatorReport report;
+    try {
+        report = run_shards(shards, cc, [&](std::size_t, ShardResult& r) {
+            if (writer) writer->write_records(r.records);
+            r.stats.shift_indices(offset);
+            for (const auto& p : r.puzzles) named[p.first + offset] = p.second;
+            offset += static_cast<int>(r.stats.count);
+            stats.merge(r.stats);
         });
     }
+    catch (std::exception& e) {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+    auto end = std::chrono::steady_clock::now();
+    const bool written = !writer || writer->close();
+    if (!written) std::cout << "Could not write result file " << cfg.output << std::endl;
+
+    for (auto k : report.lost_shards) {
+        std::cout << "LOST shard " << shards[k].path << " bytes " << shards[k].begin << "-" << shards[k].end
+            << " after " << cc.max_attempts << " attempts" << std::endl;
+    }
+    if (stats.count == 0) {
+        std::cout << "No puzzles found" << std::endl;
+        return 1;
+    }
 
+    RunSummary run;
+    run.wall_ms = 1e-3 * std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    run.solved_now = static_cast<int>(stats.count);
+    run.workers = std::to_string(cfg.processes) + " processes";
+    run.notes.push_back("Shards " + std::to_string(shards.size()) + ", worker runs " + std::to_string(report.launched)
+        + ", failed " + std::to_string(report.failed) + ", backups " + std::to_string(report.backups));
+
+    const bool ok = print_summary(cfg, stats, static_cast<int>(stats.count), run, [&](int i) { return named[i]; });
+    return ok && written && report.lost_shards.empty() ? 0 : 2;
+}
+
+int run_client(const Config& cfg) {
+    auto puzzles = read_puzzles(cfg.inputs.empty() ? std::vector<std::string>{ "-" } : cfg.inputs);
+
+    try {
+        ServerClient client(cfg.connect);
+
+        // send from a second thread so replies are read while requests are still going out
+        std::thread sender([&] {
+            for (std::size_t i = 0; i < puzzles.size(); ++i) client.send_line(puzzles[i]);
+            if (cfg.stats != StatsLevel::None) client.send_line("STATS");
+            client.finish_sending();
+        });
+
+        std::string line;
+        while (client.read_line(line)) {
+            std::cout << line << "\n";
+        }
+        std::cout.flush();
+        sender.join();
+    }
+    catch (std::exception& e) {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
     return 0;
 }
+#endif
+
+void spot_test(const std::vector<std::string>& pl, const sudoku::Options& options) {
+    OutputBuffer out(std::cout);
+    for (auto&& p : pl) {
+        report(out, p, sudoku::solve(p, options));
+    }
+}
+
+
+
+int run(const Config& cfg) {
+#ifndef _WIN32
+    if (cfg.shard_worker) return run_shard_worker(cfg);
+    if (cfg.shards > 0) return run_sharded(cfg);
+    if (!cfg.serve.empty()) return run_server(cfg);
+    if (!cfg.connect.empty()) return run_client(cfg);
+#endif
+
+    if (!cfg.inputs.empty()) {
+        auto puzzles = read_puzzles(cfg.inputs);
+        if (puzzles.empty()) {
+            std::cout << "No puzzles found" << std::endl;
+            return 1;
+        }
+        return run_batch(cfg, std::move(puzzles)) ? 0 : 2;
+    }
+
+    auto puzzles = read_puzzles({ "puzzles6_forum_hardest_1106", "puzzles2_17_clue","puzzles3_magictour_top1465" });
+    if (!puzzles.empty()) {
+        return run_batch(cfg, std::move(puzzles)) ? 0 : 2;
+    }
+
+    spot_test({
+        "1.......2..34...5..6....7.....85..9....3.6.....8.9.....2....1..7.......6..9.8..3.",
+        "........8..3...4...9..2..6.....79.......612...6.5.2.7...8...5...1.....2.4.5.....3",
+        "........2..8.1.9..5....3.4....1.93...6..3..8...37......4......53.1.7.8..2........",
+        "..2...7...1.....6.5......18....37.......49.....41.23....3.2.9...8.....5.6.......2",
+        "........7..4.2.6..8.....31......29...4..9..3...95.6....1......8..6.5.2..7......6."
+    }, cfg.options);
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    Config cfg;
+    if (!parse_args(argc, argv, cfg)) {
+        return 1;
+    }
+
+    if (cfg.trace.empty()) return run(cfg);
+
+    if (cfg.trace_events > 0) trace::set_ring_capacity(cfg.trace_events);
+    trace::enable(true);
+    const int rc = run(cfg);
+    trace::enable(false);
+
+    if (!trace::write_chrome_json(cfg.trace)) {
+        std::cout << "Could not write trace file " << cfg.trace << std::endl;
+        return rc == 0 ? 1 : rc;
+    }
+    std::cout << "Wrote " << trace::recorded_events() - trace::dropped_events() << " trace events to " << cfg.trace;
+    if (trace::dropped_events() > 0) std::cout << " (" << trace::dropped_events() << " older events dropped)";
+    std::cout << std::endl;
+    return rc;
+}
@@ -0,0 +1,41 @@
+#include "TextFormat.h"
+#include <cstring>
+
+//===============================================================================
+OutputBuffer::OutputBuffer(std::ostream& out, std::size_t capacity) : out_(out) {
+    buffer_.resize(capacity);
+}
+
+//===============================================================================
+OutputBuffer::~OutputBuffer() {
+    flush();
+}
+
+//===============================================================================
+char* OutputBuffer::reserve(std::size_t n) {
+    if (buffer_.size() - size_ < n) {
+        flush();
+        if (buffer_.size() < n) buffer_.resize(n);
+    }
+    return &buffer_[size_];
+}
+
+//===============================================================================
+OutputBuffer& OutputBuffer::operator<<(const char* s) {
+    return append(s, std::strlen(s));
+}
+
+//===============================================================================
+OutputBuffer& OutputBuffer::append(const char* s, std::size_t n) {
+    char* p = reserve(n);
+    std::memcpy(p, s, n);
+    size_ += n;
+    return *this;
+}
+
+//===============================================================================
+void OutputBuffer::flush() {
+    if (size_ == 0) return;
+    out_.write(buffer_.data(), static_cast<std::streamsize>(size_));
+    size_ = 0;
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include "bit_ops.h"
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <system_error>
+
+/*
+Formatting for the output paths that handle many puzzles: boards and
+numbers are written straight into a caller-supplied char buffer, with a
+lookup table from entry to character on 4x4 and 9x9 boards, instead of
+going through ostream insertion one piece at a time.
+
+Each format_* function writes at the given position and returns the end
+of what it wrote; nothing is null-terminated.
+*/
+
+// Character for each possible entry: its value for a single candidate, '.' otherwise
+template<unsigned B>
+constexpr std::array<char, base_mask_v<B> + 1> make_symbol_table() {
+    std::array<char, base_mask_v<B> + 1> table{};
+    for (unsigned e = 0; e <= base_mask_v<B>; ++e) {
+        table[e] = '.';
+        for (unsigned v = 0; v < B * B; ++v) {
+            if (e == (1u << v)) table[e] = value_symbols[v];
+        }
+    }
+    return table;
+}
+
+template<unsigned B>
+inline constexpr auto symbol_table_v = make_symbol_table<B>();
+
+template<unsigned B>
+inline char entry_symbol(entry_t<B> e) {
+    // 16x16 and 25x25 masks are too wide for a table
+    if constexpr (B <= 3) {
+        return symbol_table_v<B>[e & base_mask_v<B>];
+    }
+    else {
+        return has_single_value<B>(e) ? value_symbols[lowest_bit<B>(e) - 1] : '.';
+    }
+}
+
+// One character per cell in row order, '.' for undetermined cells; writes B^4 characters
+template<unsigned B>
+inline char* format_solution(const entry_t<B>* entries, char* out) {
+    constexpr unsigned cells = B * B * B * B;
+    for (unsigned i = 0; i < cells; ++i) out[i] = entry_symbol<B>(entries[i]);
+    return out + cells;
+}
+
+// Most characters format_grid<B>() writes, color codes included
+template<unsigned B>
+constexpr std::size_t grid_text_max() {
+    constexpr std::size_t N = B * B;
+    constexpr std::size_t colored = 11; // space or bar plus a character wrapped in color codes
+    constexpr std::size_t row_line = 2 + N * (B + 1) * colored + 1;
+    constexpr std::size_t border_line = 2 + B * (11 + B * (2 * B + 2)) + 1;
+    return N * B * row_line + (N + 1) * border_line;
+}
+
+/*
+The boxed grid that operator<< prints: each cell is drawn as a B x B block
+showing its value in the middle, or its remaining candidates in gray.
+out must have room for grid_text_max<B>() characters.
+*/
+template<unsigned B>
+char* format_grid(const entry_t<B>* entries, char* out) {
+    constexpr unsigned N = B * B;
+    constexpr char gray[] = "\033[90m";
+    constexpr char red[] = "\033[91m";
+    constexpr char reset[] = "\033[0m";
+
+    auto put = [&](const char* s, std::size_t n) {
+        for (std::size_t k = 0; k < n; ++k) *out++ = s[k];
+    };
+    auto colored = [&](const char* color, char c) {
+        *out++ = ' ';
+        put(color, 5);
+        *out++ = c;
+        put(reset, 4);
+    };
+
+    // border lines, e.g. "++=======+=======+=======++...++" for a 9x9 board
+    auto border = [&](bool thick) {
+        put("++", 2);
+        for (unsigned b = 0; b < B; ++b) {
+            if (!thick) put(gray, 5);
+            for (unsigned c = 0; c < B; ++c) {
+                for (unsigned k = 0; k < 2 * B + 1; ++k) *out++ = thick ? '=' : '-';
+                if (c + 1 < B) *out++ = '+';
+                else if (thick) put("++", 2);
+            }
+            if (!thick) {
+                put(reset, 4);
+                put("++", 2);
+            }
+        }
+        *out++ = '\n';
+    };
+
+    border(true);
+    for (unsigned i = 0; i < N; ++i) {
+        for (unsigned sr = 0; sr < B; ++sr) {
+            put("||", 2);
+            for (unsigned j = 0; j < N; ++j) {
+                const entry_t<B> e = entries[N * i + j];
+                const bool has_val = has_single_value<B>(e);
+
+                for (unsigned sc = 0; sc < B; ++sc) {
+                    const unsigned opt = B * sr + sc + 1;
+                    if (has_val && sc == B / 2 && sr == B / 2) {
+                        colored(red, entry_symbol<B>(e));
+                    }
+                    else if (!has_val && has_bit<B>(e, opt)) {
+                        colored(gray, value_symbols[opt - 1]);
+                    }
+                    else {
+                        put("  ", 2);
+                    }
+                }
+
+                if ((j + 1) % B == 0) {
+                    put(" ||", 3);
+                }
+                else {
+                    put(gray, 5);
+                    put(" |", 2);
+                    put(reset, 4);
+                }
+            }
+            *out++ = '\n';
+        }
+        border((i + 1) % B == 0);
+    }
+    return out;
+}
+
+// Decimal digits of v; needs up to 20 characters
+inline char* format_uint(char* out, std::uint64_t v) {
+    return std::to_chars(out, out + 20, v).ptr;
+}
+
+// Milliseconds with three decimals, as "%.3f" would print them; needs up to 32 characters
+inline char* format_ms(char* out, double ms) {
+    const auto r = std::to_chars(out, out + 32, ms, std::chars_format::fixed, 3);
+    if (r.ec == std::errc()) return r.ptr;
+    // too long for fixed notation
+    return std::to_chars(out, out + 32, ms, std::chars_format::scientific, 3).ptr;
+}
+
+/*
+Collects output in a large block and hands it to the stream in one write
+when the block fills up, so per-line output never flushes the stream.
+Whatever is left is written by flush() or the destructor.
+*/
+class OutputBuffer {
+public:
+    explicit OutputBuffer(std::ostream& out, std::size_t capacity = 1 << 16);
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+    ~OutputBuffer();
+
+    // Space for at least n more characters; pass the end of what was written to commit()
+    char* reserve(std::size_t n);
+    void commit(char* end) { size_ = static_cast<std::size_t>(end - buffer_.data()); }
+
+    OutputBuffer& operator<<(const std::string& s) { return append(s.data(), s.size()); }
+    OutputBuffer& operator<<(const char* s);
+    OutputBuffer& operator<<(char c) { return append(&c, 1); }
+    OutputBuffer& append(const char* s, std::size_t n);
+
+    void flush();
+
+private:
+    std::ostream& out_;
+    std::string buffer_;
+    std::size_t size_ = 0;
+};
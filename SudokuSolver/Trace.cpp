@@ -0,0 +1,222 @@
+#include "Trace.h"
+
+#if SUDOKU_TRACE
+
+#include "TextFormat.h"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace trace {
+
+namespace {
+
+constexpr std::size_t first_ring_events = 1 << 10;
+
+struct Event {
+    const char* name;
+    std::uint64_t begin_ns;
+    std::uint64_t end_ns;
+};
+
+/*
+Only the owning thread writes; the exporter reads after the threads are
+done. A ring starts small and doubles until it reaches the capacity, then
+wraps. When its thread exits the ring goes on a free list and the next new
+thread records into it after the old events, so threads started per
+puzzle reuse a handful of rings instead of each keeping one forever
+*/
+struct Ring {
+    std::vector<Event> events = std::vector<Event>(first_ring_events); // size is a power of two
+    std::uint64_t head = 0; // total events recorded
+    unsigned tid = 0;
+    std::string name;
+
+    std::uint64_t dropped() const { return head > events.size() ? head - events.size() : 0; }
+};
+
+std::atomic<bool> enabled_{ false };
+std::atomic<std::size_t> ring_capacity_{ std::size_t(1) << 16 };
+const auto epoch = std::chrono::steady_clock::now();
+
+std::mutex registry_mutex;
+std::vector<std::unique_ptr<Ring>> registry;
+std::vector<Ring*> free_rings;
+
+// Hands the calling thread's ring back when the thread exits
+struct RingOwner {
+    Ring* ring;
+
+    RingOwner() {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        if (!free_rings.empty()) {
+            ring = free_rings.back();
+            free_rings.pop_back();
+        }
+        else {
+            registry.push_back(std::make_unique<Ring>());
+            ring = registry.back().get();
+            ring->tid = static_cast<unsigned>(registry.size());
+        }
+    }
+    RingOwner(const RingOwner&) = delete;
+    RingOwner& operator=(const RingOwner&) = delete;
+    ~RingOwner() {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        free_rings.push_back(ring);
+    }
+};
+
+//===============================================================================
+Ring& thread_ring() {
+    thread_local RingOwner owner;
+    return *owner.ring;
+}
+
+//===============================================================================
+void append_json_name(std::string& out, const std::string& s) {
+    // span and thread names are our own, so only quotes and backslashes need care
+    out += '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    out += '"';
+}
+
+//===============================================================================
+void append_us(std::string& out, std::uint64_t ns) {
+    // microseconds with nanosecond precision, as the trace format expects
+    char buf[32];
+    char* p = format_uint(buf, ns / 1000);
+    *p++ = '.';
+    const unsigned frac = static_cast<unsigned>(ns % 1000);
+    *p++ = char('0' + frac / 100);
+    *p++ = char('0' + frac / 10 % 10);
+    *p++ = char('0' + frac % 10);
+    out.append(buf, p);
+}
+
+} // namespace
+
+//===============================================================================
+void enable(bool on) {
+    enabled_.store(on, std::memory_order_relaxed);
+}
+
+//===============================================================================
+bool enabled() {
+    return enabled_.load(std::memory_order_relaxed);
+}
+
+//===============================================================================
+std::uint64_t now_ns() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - epoch).count());
+}
+
+//===============================================================================
+void record(const char* name, std::uint64_t begin_ns, std::uint64_t end_ns) {
+    Ring& r = thread_ring();
+    if (r.head == r.events.size() && r.events.size() < ring_capacity_.load(std::memory_order_relaxed)) {
+        // not wrapped yet, so the events are in order and stay where they are
+        r.events.resize(r.events.size() * 2);
+    }
+    r.events[r.head & (r.events.size() - 1)] = Event{ name, begin_ns, end_ns };
+    ++r.head;
+}
+
+//===============================================================================
+void set_ring_capacity(std::size_t events) {
+    std::size_t n = first_ring_events;
+    while (n < events && n < (std::size_t(1) << 30)) n *= 2;
+    ring_capacity_.store(n, std::memory_order_relaxed);
+}
+
+//===============================================================================
+void set_thread_name(const std::string& name) {
+    thread_ring().name = name;
+}
+
+//===============================================================================
+std::uint64_t recorded_events() {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    std::uint64_t n = 0;
+    for (const auto& r : registry) n += r->head;
+    return n;
+}
+
+//===============================================================================
+std::uint64_t dropped_events() {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    std::uint64_t n = 0;
+    for (const auto& r : registry) n += r->dropped();
+    return n;
+}
+
+//===============================================================================
+bool write_chrome_json(const std::string& path) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) return false;
+
+    std::lock_guard<std::mutex> lock(registry_mutex);
+
+    std::string text = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    bool first = true;
+    auto separator = [&] {
+        if (!first) text += ",\n";
+        first = false;
+    };
+
+    for (const auto& r : registry) {
+        const std::string tid = std::to_string(r->tid);
+
+        separator();
+        text += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + tid + ",\"args\":{\"name\":";
+        append_json_name(text, r->name.empty() ? "thread " + tid : r->name);
+        text += "}}";
+
+        /* Oldest surviving event first; anything older was overwritten */
+        const std::uint64_t mask = r->events.size() - 1;
+        for (std::uint64_t k = r->dropped(); k < r->head; ++k) {
+            const Event& e = r->events[k & mask];
+            separator();
+            text += "{\"name\":\"";
+            text += e.name;
+            text += "\",\"ph\":\"X\",\"pid\":1,\"tid\":" + tid + ",\"ts\":";
+            append_us(text, e.begin_ns);
+            text += ",\"dur\":";
+            append_us(text, e.end_ns - e.begin_ns);
+            text += '}';
+
+            if (text.size() > (1 << 20)) {
+                out.write(text.data(), static_cast<std::streamsize>(text.size()));
+                text.clear();
+            }
+        }
+    }
+    text += "\n]}\n";
+    out.write(text.data(), static_cast<std::streamsize>(text.size()));
+    return static_cast<bool>(out);
+}
+
+} // namespace trace
+
+#else
+
+namespace trace {
+
+void enable(bool) {}
+bool enabled() { return false; }
+void set_ring_capacity(std::size_t) {}
+void set_thread_name(const std::string&) {}
+bool write_chrome_json(const std::string&) { return false; }
+std::uint64_t recorded_events() { return 0; }
+std::uint64_t dropped_events() { return 0; }
+
+} // namespace trace
+
+#endif
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+Timeline tracing of solver activity, exported as Chrome trace-event JSON
+(load it in chrome://tracing or ui.perfetto.dev).
+
+Configure with -DSUDOKU_TRACE=ON to build it in. Each thread records
+begin/end times of SUDOKU_TRACE_SCOPE spans into its own ring buffer,
+which grows up to a set capacity and then wraps, so recording takes no
+locks and a long run keeps only its most recent events per thread. Rings
+of exited threads are reused by new ones, so a row in the timeline can
+hold several short-lived threads one after another, labelled with the
+last name set on it. Recording also has to be switched on at run
+time with trace::enable(); until then a span costs one relaxed load.
+
+Without SUDOKU_TRACE the macros expand to nothing and the functions below
+are no-ops.
+*/
+
+namespace trace {
+
+// Start or stop recording on every thread
+void enable(bool on);
+bool enabled();
+
+/*
+Most events kept per ring (rounded up to a power of two, at least
+1024, default 65536);
+applies as rings grow
+*/
+void set_ring_capacity(std::size_t events);
+
+// Label for the calling thread in the exported timeline
+void set_thread_name(const std::string& name);
+
+/*
+Write every thread's buffered events to path. Call it once the traced
+threads are done; returns false if the file could not be written.
+*/
+bool write_chrome_json(const std::string& path);
+
+// Events recorded so far and events lost to ring buffer wrap-around
+std::uint64_t recorded_events();
+std::uint64_t dropped_events();
+
+#if SUDOKU_TRACE
+constexpr bool compiled_in = true;
+
+std::uint64_t now_ns();
+void record(const char* name, std::uint64_t begin_ns, std::uint64_t end_ns);
+
+// Records the time from construction to destruction as one span; name must be a string literal
+class Scope {
+public:
+    explicit Scope(const char* name) : name_(enabled() ? name : nullptr), begin_(name_ ? now_ns() : 0) {}
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+    ~Scope() {
+        if (name_) record(name_, begin_, now_ns());
+    }
+
+private:
+    const char* name_;
+    std::uint64_t begin_;
+};
+#else
+constexpr bool compiled_in = false;
+#endif
+
+} // namespace trace
+
+#if SUDOKU_TRACE
+#define SUDOKU_TRACE_CONCAT2(a, b) a##b
+#define SUDOKU_TRACE_CONCAT(a, b) SUDOKU_TRACE_CONCAT2(a, b)
+#define SUDOKU_TRACE_SCOPE(name) ::trace::Scope SUDOKU_TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#else
+#define SUDOKU_TRACE_SCOPE(name) ((void)0)
+#endif
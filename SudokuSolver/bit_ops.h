@@ -2,15 +2,24 @@
 
 #include "Puzzle.h"
 #include <bitset>
-#include <ostream>
-#include <sstream>
+#include <string>
 
-inline bool is_locked(const Entry& i) {
-    return (i & lock_mask) > 0;
+/*
+Helpers for working with a single Entry. The box size B defaults to the
+9x9 board; the templated solver passes its own B explicitly.
+*/
+
+// Characters used for values 1..25, so 16x16 and 25x25 boards can be read and printed
+constexpr const char* value_symbols = "123456789ABCDEFGHIJKLMNOP";
+
+template<unsigned B = 3>
+inline bool is_locked(const entry_t<B>& i) {
+    return (i & lock_mask_v<B>) > 0;
 }
 
-inline unsigned count_bits(Entry i) {
-    i &= base_mask;
+template<unsigned B = 3>
+inline unsigned count_bits(entry_t<B> i) {
+    i &= base_mask_v<B>;
     unsigned count = 0;
     while (i) {
         i &= (i - 1);
@@ -19,13 +28,15 @@ inline unsigned count_bits(Entry i) {
     return count;
 }
 
-inline bool has_bit(const Entry& e, const int& i) {
-    const Entry mask = (1 << (i - 1));
+template<unsigned B = 3>
+inline bool has_bit(const entry_t<B>& e, const int& i) {
+    const entry_t<B> mask = entry_t<B>(1u << (i - 1));
     return (mask & e) > 0;
 }
 
-inline unsigned lowest_bit(Entry i) {
-    i &= base_mask;
+template<unsigned B = 3>
+inline unsigned lowest_bit(entry_t<B> i) {
+    i &= base_mask_v<B>;
 
     if (i == 0) return 0;
 
@@ -37,42 +48,44 @@ inline unsigned lowest_bit(Entry i) {
     return bit;
 }
 
-inline bool has_single_value(Entry i) {
-    return count_bits(i) == 1;
+template<unsigned B = 3>
+inline bool has_single_value(entry_t<B> i) {
+    // exactly one value bit set, without counting them all
+    i &= base_mask_v<B>;
+    return i != 0 && (i & (i - 1)) == 0;
 }
 
-inline bool remove_values(Entry& e, Entry i) {
-    if (is_locked(e)) return false;
+template<unsigned B = 3>
+inline bool remove_values(entry_t<B>& e, entry_t<B> i) {
+    if (is_locked<B>(e)) return false;
 
-    i &= base_mask;
-    const Entry eold = e;
-    e &= ((~i) & base_mask);
+    i &= base_mask_v<B>;
+    const entry_t<B> eold = e;
+    e &= ((~i) & base_mask_v<B>);
     return e != eold;
 }
 
-
-inline std::string entity_bits(Entry i) {
-    std::ostringstream bits;
-    std::bitset<10> y(i);
-    bits << y;
-    return bits.str();
+// Value (1..N) for a puzzle character, or 0 for an empty cell
+template<unsigned B = 3>
+inline unsigned symbol_value(char c) {
+    if (c >= 'a' && c <= 'z') c = char(c - 'a' + 'A');
+    for (unsigned v = 0; v < B * B; ++v) {
+        if (value_symbols[v] == c) return v + 1;
+    }
+    return 0;
 }
 
-inline std::string entity_str(Entry i) {
-    std::ostringstream p;
-    if (has_single_value(i)) {
-        p << lowest_bit(i);
-    }
-    else {
-        p << "_";
-    }
+template<unsigned B = 3>
+inline std::string entity_bits(entry_t<B> i) {
+    return std::bitset<B * B + 1>(i).to_string();
+}
 
-    return p.str();
+template<unsigned B = 3>
+inline std::string entity_str(entry_t<B> i) {
+    return std::string(1, has_single_value<B>(i) ? value_symbols[lowest_bit<B>(i) - 1] : '_');
 }
 
+template<unsigned B = 3>
 inline unsigned entry_box_id(unsigned i) {
-    const unsigned box_col = (i % 9) / 3;
-    const unsigned box_row = i / 27;
-    return 3 * box_row + box_col;
+    return cell_box<B>(i);
 }
-
@@ -0,0 +1,322 @@
+
+#include "sudoku.h"
+#include "LaneSolver.h"
+#include "ParallelSearch.h"
+#include "Puzzle.h"
+#include "bit_ops.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace sudoku {
+
+namespace {
+
+//===============================================================================
+template<unsigned B>
+Result solve_board(const std::string& grid, const Options& options) {
+    if (options.engine == Engine::Rules && options.threads > 1) {
+        return solve_parallel<B>(grid, options, options.threads);
+    }
+
+    BasicPuzzle<B> p(grid, options.memory);
+    p.set_time_limit(options.timeout_ms);
+    p.set_undo_mode(options.undo);
+    p.set_branching(options.branching);
+    p.set_rules(options.rules);
+
+    if (options.engine == Engine::Recurse) {
+        p.solve_recurse();
+    }
+    else {
+        p.solve();
+    }
+
+    return p.result();
+}
+
+//===============================================================================
+template<unsigned B>
+unsigned count_from(const std::string& grid, const typename BasicPuzzle<B>::Entries& state, unsigned limit) {
+    // propagate, then try every option of the guess cell on a copy of the board
+    BasicPuzzle<B> p(grid, state);
+    switch (p.propagate()) {
+    case Status::Solved:     return 1;
+    case Status::NoSolution: return 0;
+    default:                 break;
+    }
+
+    const int cell = p.guess_cell();
+    const auto options = p.state()[cell];
+    unsigned found = 0;
+    for (unsigned v = 1; v <= BasicPuzzle<B>::N && found < limit; ++v) {
+        if (!has_bit<B>(options, v)) continue;
+        auto child = p.state();
+        child[cell] = typename BasicPuzzle<B>::Entry(1u << (v - 1));
+        found += count_from<B>(grid, child, limit - found);
+    }
+    return found;
+}
+
+//===============================================================================
+template<unsigned B>
+unsigned count_board(const std::string& grid, unsigned limit) {
+    return count_from<B>(grid, BasicPuzzle<B>(grid).state(), limit);
+}
+
+//===============================================================================
+template<unsigned B>
+std::vector<unsigned> redundant_from(const std::string& grid, const std::vector<unsigned>& cells, unsigned threads,
+    bool first_only = false) {
+    /*
+    grid has a unique solution, so the clue at a cell can go exactly when
+    no solution of the other clues puts a different value there. That is
+    one solve of the parsed clues with the cell's candidates inverted,
+    which mostly ends in propagation, rather than counting the solutions
+    of the reduced puzzle up to 2. These boards have few clues, where
+    guessing on singles alone is about 2.5x faster than the full rule set
+    (the 17-clue archive). The trials are independent and run on
+    up to threads workers, each with its own pool for the guess stacks.
+    first_only stops the trials once any redundant clue is found
+    */
+    using Board = BasicPuzzle<B>;
+    using Entry = typename Board::Entry;
+    const typename Board::Entries clues = Board(grid).state();
+
+    std::vector<char> redundant(cells.size(), 0);
+    std::atomic<std::size_t> next{ 0 };
+    std::atomic<bool> found{ false };
+
+    auto worker = [&] {
+        std::pmr::unsynchronized_pool_resource arena;
+        for (std::size_t k = next++; k < cells.size() && !(first_only && found); k = next++) {
+            auto state = clues;
+            state[cells[k]] = Entry(base_mask_v<B> & ~clues[cells[k]]);
+            Board p(grid, state, &arena);
+            p.set_rules(RuleSet::Singles);
+            p.solve();
+            redundant[k] = p.status() == Status::NoSolution;
+            if (redundant[k]) found = true;
+        }
+    };
+
+    const unsigned n = static_cast<unsigned>(std::min<std::size_t>(std::max(1u, threads), cells.size()));
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < n; ++t) workers.emplace_back(worker);
+    worker();
+    for (auto& w : workers) w.join();
+
+    std::vector<unsigned> out;
+    for (std::size_t k = 0; k < cells.size(); ++k) {
+        if (redundant[k]) out.push_back(cells[k]);
+    }
+    return out;
+}
+
+//===============================================================================
+template<unsigned B>
+std::vector<unsigned> clue_cells(const std::string& grid) {
+    std::vector<unsigned> cells;
+    for (unsigned i = 0; i < grid.size(); ++i) {
+        if (symbol_value<B>(grid[i]) > 0) cells.push_back(i);
+    }
+    return cells;
+}
+
+//===============================================================================
+template<unsigned B>
+std::vector<unsigned> redundant_board(const std::string& grid, unsigned threads) {
+    if (count_board<B>(grid, 2) != 1) return {};
+    return redundant_from<B>(grid, clue_cells<B>(grid), threads);
+}
+
+//===============================================================================
+template<unsigned B>
+bool minimal_board(const std::string& grid, unsigned threads) {
+    return count_board<B>(grid, 2) == 1 && redundant_from<B>(grid, clue_cells<B>(grid), threads, true).empty();
+}
+
+//===============================================================================
+template<unsigned B>
+std::string minimize_board(const std::string& grid, unsigned threads) {
+    /*
+    Taking a clue away only adds solutions, so a clue that can't go now
+    can't go later either: each round re-checks just the clues that were
+    still redundant and drops the first of them. The result is the same
+    as trying every clue in cell order
+    */
+    if (count_board<B>(grid, 2) != 1) return grid;
+
+    std::string g = grid;
+    std::vector<unsigned> candidates = clue_cells<B>(grid);
+    while (true) {
+        const auto redundant = redundant_from<B>(g, candidates, threads);
+        if (redundant.empty()) break;
+        g[redundant.front()] = '.';
+        candidates.assign(redundant.begin() + 1, redundant.end());
+    }
+    return g;
+}
+
+} // namespace
+
+//===============================================================================
+Result solve(const std::string& grid, const Options& options) {
+    if (options.engine == Engine::Lanes) {
+        return solve_lanes({ grid }, options).front();
+    }
+
+    switch (grid.size()) {
+    case 16:  return solve_board<2>(grid, options);
+    case 81:  return solve_board<3>(grid, options);
+    case 256: return solve_board<4>(grid, options);
+    case 625: return solve_board<5>(grid, options);
+    default:
+        Result r;
+        r.status = Status::InvalidInput;
+        return r;
+    }
+}
+
+//===============================================================================
+struct ResumableSolve::Board {
+    virtual ~Board() = default;
+    virtual bool advance(unsigned steps) = 0;
+    virtual Result result() const = 0;
+};
+
+template<unsigned B>
+struct ResumableSolve::BoardOf : ResumableSolve::Board {
+    BoardOf(const std::string& grid, const Options& options) : puzzle(grid, options.memory) {
+        puzzle.set_time_limit(options.timeout_ms);
+        puzzle.set_undo_mode(options.undo);
+        puzzle.set_branching(options.branching);
+        puzzle.set_rules(options.rules);
+        puzzle.start_solve();
+    }
+    bool advance(unsigned steps) override { return puzzle.advance(steps); }
+    Result result() const override { return puzzle.result(); }
+
+    BasicPuzzle<B> puzzle;
+};
+
+//===============================================================================
+ResumableSolve::ResumableSolve(const std::string& grid, const Options& options) : grid_(grid), options_(options) {
+    // only the single-threaded rules engine can stop and resume; everything else is solved in one go by step()
+    if (options.engine != Engine::Rules || options.threads > 1) return;
+
+    switch (grid.size()) {
+    case 16:  board_ = std::make_unique<BoardOf<2>>(grid, options); break;
+    case 81:  board_ = std::make_unique<BoardOf<3>>(grid, options); break;
+    case 256: board_ = std::make_unique<BoardOf<4>>(grid, options); break;
+    case 625: board_ = std::make_unique<BoardOf<5>>(grid, options); break;
+    default:
+        result_.status = Status::InvalidInput;
+        done_ = true;
+        break;
+    }
+}
+
+ResumableSolve::~ResumableSolve() = default;
+ResumableSolve::ResumableSolve(ResumableSolve&&) noexcept = default;
+ResumableSolve& ResumableSolve::operator=(ResumableSolve&&) noexcept = default;
+
+//===============================================================================
+bool ResumableSolve::step(unsigned max_steps) {
+    if (done_) return true;
+
+    if (!board_) {
+        result_ = solve(grid_, options_);
+        done_ = true;
+    }
+    else if (board_->advance(std::max(1u, max_steps))) {
+        result_ = board_->result();
+        board_.reset();
+        done_ = true;
+    }
+    return done_;
+}
+
+//===============================================================================
+unsigned count_solutions(const std::string& grid, unsigned limit) {
+    if (limit == 0) return 0;
+    switch (grid.size()) {
+    case 16:  return count_board<2>(grid, limit);
+    case 81:  return count_board<3>(grid, limit);
+    case 256: return count_board<4>(grid, limit);
+    case 625: return count_board<5>(grid, limit);
+    default:  return 0;
+    }
+}
+
+//===============================================================================
+std::vector<unsigned> redundant_clues(const std::string& grid, unsigned threads) {
+    switch (grid.size()) {
+    case 16:  return redundant_board<2>(grid, threads);
+    case 81:  return redundant_board<3>(grid, threads);
+    case 256: return redundant_board<4>(grid, threads);
+    case 625: return redundant_board<5>(grid, threads);
+    default:  return {};
+    }
+}
+
+//===============================================================================
+bool is_minimal(const std::string& grid, unsigned threads) {
+    switch (grid.size()) {
+    case 16:  return minimal_board<2>(grid, threads);
+    case 81:  return minimal_board<3>(grid, threads);
+    case 256: return minimal_board<4>(grid, threads);
+    case 625: return minimal_board<5>(grid, threads);
+    default:  return false;
+    }
+}
+
+//===============================================================================
+std::string minimize(const std::string& grid, unsigned threads) {
+    switch (grid.size()) {
+    case 16:  return minimize_board<2>(grid, threads);
+    case 81:  return minimize_board<3>(grid, threads);
+    case 256: return minimize_board<4>(grid, threads);
+    case 625: return minimize_board<5>(grid, threads);
+    default:  return grid;
+    }
+}
+
+//===============================================================================
+std::vector<Result> solve_batch(const std::vector<std::string>& grids, const Options& options) {
+    if (options.engine == Engine::Lanes) {
+        return solve_lanes(grids, options);
+    }
+
+    std::vector<Result> results;
+    results.reserve(grids.size());
+    for (auto& grid : grids) results.push_back(solve(grid, options));
+    return results;
+}
+
+//===============================================================================
+const char* branching_name(Branching branching) {
+    switch (branching) {
+    case Branching::Mrv:       return "mrv";
+    case Branching::UnitDigit: return "unit";
+    case Branching::Degree:    return "degree";
+    case Branching::Frequency: return "freq";
+    }
+    return "unknown";
+}
+
+//===============================================================================
+const char* status_name(Status status) {
+    switch (status) {
+    case Status::Unsolved:       return "unsolved";
+    case Status::Solved:         return "solved";
+    case Status::NoSolution:     return "no_solution";
+    case Status::IterationLimit: return "iteration_limit";
+    case Status::Timeout:        return "timeout";
+    case Status::InvalidInput:   return "invalid_input";
+    case Status::Failed:         return "failed";
+    }
+    return "unknown";
+}
+
+} // namespace sudoku
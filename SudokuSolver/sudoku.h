@@ -0,0 +1,153 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+/*
+Public interface of the sudoku_core library.
+
+Boards are passed as one character per cell in row order: "1-9" then "A-P"
+for values and '.' (or any other character) for an empty cell. The board
+size is taken from the length of the string: 16 (4x4), 81 (9x9), 256 (16x16)
+or 625 (25x25).
+
+Nothing in here writes to the console; callers decide what to report.
+*/
+
+namespace sudoku {
+
+constexpr unsigned num_rules = 5;
+
+enum class Status {
+    Unsolved,       // not attempted yet
+    Solved,
+    NoSolution,     // every branch of the search reached a contradiction
+    IterationLimit, // gave up after the maximum number of solver steps
+    Timeout,        // gave up after Options::timeout_ms
+    InvalidInput,   // the grid string has an unsupported length
+    Failed          // the solver reached an inconsistent internal state
+};
+
+enum class Engine {
+    Rules,   // deduction rules with guessing as a fallback (fastest)
+    Recurse, // plain backtracking search
+    Lanes    // 9x9 puzzles propagated 16 at a time in SIMD lanes, then Rules (best with solve_batch)
+};
+
+// How the rules engine takes back a failed guess
+enum class Undo {
+    Snapshot, // restore a copy of the whole board saved at the guess
+    Trail     // replay a log of the cells changed since the guess
+};
+
+// How the rules engine picks the cell and value to guess
+enum class Branching {
+    Mrv,       // first cell with the fewest options, lowest value first
+    UnitDigit, // also consider a value with few places left in a set
+    Degree,    // fewest options, ties broken by most undetermined peers
+    Frequency  // fewest options, least constraining value first
+};
+
+// Which deduction rules the rules engine runs before it falls back to guessing
+enum class RuleSet {
+    Singles, // naked and hidden singles
+    Subsets, // singles plus naked and hidden subsets
+    Full     // all rules, including box/line intersections
+};
+
+struct Options {
+    Engine engine = Engine::Rules;
+    double timeout_ms = 0.0; // per-puzzle time limit, 0 for none
+    unsigned threads = 1;    // threads searching each puzzle (rules engine only)
+    Undo undo = Undo::Snapshot;
+    Branching branching = Branching::Mrv;
+    RuleSet rules = RuleSet::Full;
+    /* Where the rules engine allocates its guess stack and undo trail, the
+       default heap if null. A per-thread pool keeps batch workers off the
+       shared heap; it must outlive the solve and is not used by the
+       threads of Options::threads > 1 */
+    std::pmr::memory_resource* memory = nullptr;
+};
+
+struct Stats {
+    double elapsed_ms = 0.0;
+    unsigned guesses = 0;
+    std::uint64_t undo_bytes = 0; // board state copied to save and take back guesses
+    std::array<unsigned, num_rules> rule_calls{};
+    std::array<unsigned, num_rules> rule_applies{};
+    bool cache_hit = false; // answered from a SolutionCache without solving
+};
+
+struct Result {
+    Status status = Status::Unsolved;
+    std::string solution; // same format as the input, empty unless solved
+    Stats stats;
+};
+
+Result solve(const std::string& grid, const Options& options = Options());
+
+/*
+A solve that runs in slices, so one thread can interleave many puzzles
+(e.g. from an event loop) without any of them blocking the others. Each
+step() runs at most max_steps passes of the rules engine (one rule pass
+or one guess each) and returns true once the puzzle is finished; the
+board and the open guesses are kept in between. result() is complete
+once step() has returned true; stats.elapsed_ms and Options::timeout_ms
+count only the time spent inside step().
+
+Other engines, and Options::threads > 1, solve the whole puzzle in the
+first step().
+*/
+class ResumableSolve {
+public:
+    explicit ResumableSolve(const std::string& grid, const Options& options = Options());
+    ~ResumableSolve();
+    ResumableSolve(ResumableSolve&&) noexcept;
+    ResumableSolve& operator=(ResumableSolve&&) noexcept;
+
+    bool step(unsigned max_steps = 100);
+    bool done() const { return done_; }
+    const Result& result() const { return result_; }
+
+private:
+    struct Board;
+    template<unsigned B> struct BoardOf;
+
+    std::string grid_;
+    Options options_;
+    std::unique_ptr<Board> board_;
+    Result result_;
+    bool done_ = false;
+};
+
+/*
+Number of solutions of a puzzle, counting stops at limit (so the default
+tells unique puzzles from ones with several solutions). 0 for unsolvable
+or invalid grids.
+*/
+unsigned count_solutions(const std::string& grid, unsigned limit = 2);
+
+/*
+Clue minimality. A puzzle with a unique solution is minimal when taking
+away any one clue leaves it with several solutions. redundant_clues()
+lists the cells whose clue could be taken away on its own, is_minimal()
+is true when there are none, and minimize() takes redundant clues away
+one at a time, in cell order, until the puzzle is minimal. Puzzles
+without a unique solution have no redundant clues, are not minimal and
+are returned unchanged. threads spreads the removal trials of one puzzle.
+*/
+std::vector<unsigned> redundant_clues(const std::string& grid, unsigned threads = 1);
+bool is_minimal(const std::string& grid, unsigned threads = 1);
+std::string minimize(const std::string& grid, unsigned threads = 1);
+
+// Solve several puzzles; the results are in the same order as the grids
+std::vector<Result> solve_batch(const std::vector<std::string>& grids, const Options& options = Options());
+
+const char* status_name(Status status);
+const char* branching_name(Branching branching);
+
+} // namespace sudoku
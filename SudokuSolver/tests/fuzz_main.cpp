@@ -0,0 +1,47 @@
+/*
+Stand-in for the libFuzzer driver when the compiler does not provide one:
+replays each line of the files given on the command line through the fuzz
+target, or without files, a fixed number of pseudo-random inputs.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, std::size_t size);
+
+int main(int argc, char* argv[]) {
+    std::size_t runs = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        std::ifstream in(argv[i]);
+        if (!in) {
+            std::cerr << "Could not open " << argv[i] << std::endl;
+            return 1;
+        }
+        std::string line;
+        while (std::getline(in, line)) {
+            LLVMFuzzerTestOneInput(reinterpret_cast<const std::uint8_t*>(line.data()), line.size());
+            ++runs;
+        }
+    }
+
+    if (argc == 1) {
+        // mostly sparse 81-byte grids, with some short and long inputs mixed in
+        std::mt19937 rng(12345);
+        for (; runs < 3000; ++runs) {
+            std::vector<std::uint8_t> data(runs % 10 == 0 ? rng() % 700 : 81);
+            const unsigned density = 2 + rng() % 4;
+            for (auto& d : data) d = std::uint8_t(rng() % density == 0 ? rng() : 0);
+            LLVMFuzzerTestOneInput(data.data(), data.size());
+        }
+    }
+
+    std::cout << "Ran " << runs << " inputs" << std::endl;
+    return 0;
+}
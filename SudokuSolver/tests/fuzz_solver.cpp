@@ -0,0 +1,69 @@
+/*
+libFuzzer entry point for the grid parser and the solver engines.
+
+The raw input is passed to sudoku::solve() as it is, to exercise length
+and character handling. It is also mapped onto a 9x9 grid (byte % 10,
+0 for an empty cell), which is run through every engine: any solution
+must be valid and keep the givens, engines that finish must agree on
+whether the grid can be solved, and the solution counter must agree too.
+Any disagreement aborts, which libFuzzer reports as a crash.
+*/
+
+#include "../sudoku.h"
+#include "solution_checks.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+void check(bool ok, const char* what, const std::string& grid) {
+    if (ok) return;
+    std::fprintf(stderr, "%s\n%s\n", what, grid.c_str());
+    std::abort();
+}
+
+bool finished(sudoku::Status s) {
+    return s == sudoku::Status::Solved || s == sudoku::Status::NoSolution;
+}
+
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, std::size_t size) {
+    sudoku::Options opts;
+    opts.timeout_ms = 200.0;
+
+    const std::string raw(reinterpret_cast<const char*>(data), size);
+    const sudoku::Result r0 = sudoku::solve(raw, opts);
+    if (r0.status == sudoku::Status::Solved) check(is_valid_solution(raw, r0.solution), "invalid solution for raw input", raw);
+
+    std::string grid(81, '.');
+    for (std::size_t i = 0; i < size && i < 81; ++i) {
+        const unsigned v = data[i] % 10;
+        if (v != 0) grid[i] = char('0' + v);
+    }
+
+    const sudoku::Result rules = sudoku::solve(grid, opts);
+    if (!finished(rules.status)) return 0;
+    if (rules.status == sudoku::Status::Solved) check(is_valid_solution(grid, rules.solution), "invalid rules solution", grid);
+
+    const unsigned count = sudoku::count_solutions(grid, 2);
+    check((count > 0) == (rules.status == sudoku::Status::Solved), "count_solutions disagrees with solve", grid);
+
+    sudoku::Options other = opts;
+    for (auto engine : { sudoku::Engine::Lanes, sudoku::Engine::Recurse }) {
+        other.engine = engine;
+        other.timeout_ms = engine == sudoku::Engine::Recurse ? 20.0 : opts.timeout_ms;
+
+        const sudoku::Result r = sudoku::solve(grid, other);
+        if (!finished(r.status)) continue;
+        check(r.status == rules.status, "engines disagree on solvability", grid);
+        if (r.status == sudoku::Status::Solved) {
+            check(is_valid_solution(grid, r.solution), "invalid solution", grid);
+            if (count == 1) check(r.solution == rules.solution, "engines disagree on a unique solution", grid);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+
+// True if solution is a complete, valid board of the same size that keeps every given of puzzle
+inline bool is_valid_solution(const std::string& puzzle, const std::string& solution) {
+    static const std::string symbols = "123456789ABCDEFGHIJKLMNOP";
+
+    unsigned b = 0;
+    while (b * b * b * b < puzzle.size()) ++b;
+    const unsigned n = b * b;
+    if (n * n != puzzle.size() || solution.size() != puzzle.size()) return false;
+
+    for (unsigned i = 0; i < n * n; ++i) {
+        const auto v = symbols.find(solution[i]);
+        if (v == std::string::npos || v >= n) return false;
+
+        const auto given = symbols.find(puzzle[i]);
+        if (given != std::string::npos && given < n && puzzle[i] != solution[i]) return false;
+    }
+
+    for (unsigned k = 0; k < n; ++k) {
+        unsigned long long row = 0, col = 0, box = 0;
+        for (unsigned m = 0; m < n; ++m) {
+            row |= 1ull << symbols.find(solution[n * k + m]);
+            col |= 1ull << symbols.find(solution[n * m + k]);
+            box |= 1ull << symbols.find(solution[b * n * (k / b) + b * (k % b) + n * (m / b) + m % b]);
+        }
+        const unsigned long long full = (1ull << n) - 1;
+        if (row != full || col != full || box != full) return false;
+    }
+    return true;
+}
@@ -0,0 +1,199 @@
+#include "test_macros.h"
+#include "../sudoku.h"
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+TEST(Api_Solve) {
+    const std::string grid = "1.......2..34...5..6....7.....85..9....3.6.....8.9.....2....1..7.......6..9.8..3.";
+    const auto r = sudoku::solve(grid);
+
+    EXPECT_TRUE((r.status == sudoku::Status::Solved));
+    EXPECT_EQ(81u, r.solution.size());
+    EXPECT_TRUE((r.solution.find('.') == std::string::npos));
+    EXPECT_TRUE((r.stats.rule_calls[0] > 0));
+
+    // givens are kept
+    bool kept = true;
+    for (unsigned i = 0; i < 81; ++i) {
+        if (grid[i] != '.' && grid[i] != r.solution[i]) kept = false;
+    }
+    EXPECT_TRUE(kept);
+
+    sudoku::Options opts;
+    opts.engine = sudoku::Engine::Recurse;
+    const auto rr = sudoku::solve(grid, opts);
+    EXPECT_TRUE((rr.status == sudoku::Status::Solved));
+    EXPECT_TRUE((rr.solution == r.solution));
+}
+
+TEST(Api_SolveFailures) {
+    EXPECT_TRUE((sudoku::solve("12345").status == sudoku::Status::InvalidInput));
+
+    // two 1s in the first row
+    const std::string bad = "11" + std::string(79, '.');
+    const auto r = sudoku::solve(bad);
+    EXPECT_TRUE((r.status == sudoku::Status::NoSolution));
+    EXPECT_TRUE(r.solution.empty());
+
+    sudoku::Options opts;
+    opts.engine = sudoku::Engine::Recurse;
+    EXPECT_TRUE((sudoku::solve(bad, opts).status == sudoku::Status::NoSolution));
+}
+
+TEST(Api_SolveOtherSizes) {
+    const auto r = sudoku::solve("1.....3..2.....4");
+    EXPECT_TRUE((r.status == sudoku::Status::Solved));
+    EXPECT_EQ(16u, r.solution.size());
+}
+
+TEST(Api_SolveBatchLanes) {
+    std::vector<std::string> grids = {
+        // no guessing needed
+        "..3.2.6..9..3.5..1..18.64....81.29..7.......8..67.82....26.95..8..2.3..9..5.1.3..",
+        // needs guessing
+        "..39.....4...8..36..8...1...4..6..738......1......2.....4.7..686........7.....5..",
+        // two 1s in the first row
+        "11" + std::string(79, '.'),
+        "1.....3..2.....4",
+        "12345"
+    };
+    // more than one group of lanes
+    for (int i = 0; i < 20; ++i) grids.push_back(grids[i % 2]);
+
+    sudoku::Options lanes;
+    lanes.engine = sudoku::Engine::Lanes;
+    const auto rs = sudoku::solve_batch(grids, lanes);
+    const auto expected = sudoku::solve_batch(grids);
+
+    EXPECT_EQ(grids.size(), rs.size());
+    for (std::size_t i = 0; i < grids.size(); ++i) {
+        EXPECT_TRUE((rs[i].status == expected[i].status));
+        EXPECT_TRUE((rs[i].solution == expected[i].solution));
+    }
+    EXPECT_EQ(0u, rs[0].stats.guesses);
+    EXPECT_TRUE((rs[1].stats.guesses > 0));
+    EXPECT_TRUE((rs[2].status == sudoku::Status::NoSolution));
+    EXPECT_TRUE((rs[4].status == sudoku::Status::InvalidInput));
+
+    EXPECT_TRUE((sudoku::solve(grids[1], lanes).solution == expected[1].solution));
+}
+
+TEST(Api_Branching) {
+    const std::vector<std::string> grids = {
+        "..39.....4...8..36..8...1...4..6..738......1......2.....4.7..686........7.....5..",
+        "........8..3...4...9..2..6.....79.......612...6.5.2.7...8...5...1.....2.4.5.....3",
+        "11" + std::string(79, '.')
+    };
+    const auto expected = sudoku::solve_batch(grids);
+
+    for (auto b : { sudoku::Branching::UnitDigit, sudoku::Branching::Degree, sudoku::Branching::Frequency }) {
+        for (auto undo : { sudoku::Undo::Snapshot, sudoku::Undo::Trail }) {
+            sudoku::Options opts;
+            opts.branching = b;
+            opts.undo = undo;
+            const auto rs = sudoku::solve_batch(grids, opts);
+            for (std::size_t i = 0; i < grids.size(); ++i) {
+                EXPECT_TRUE((rs[i].status == expected[i].status));
+                EXPECT_TRUE((rs[i].solution == expected[i].solution));
+            }
+        }
+    }
+    EXPECT_TRUE((std::string(sudoku::branching_name(sudoku::Branching::UnitDigit)) == "unit"));
+}
+
+TEST(Api_ResumableSolve) {
+    const std::vector<std::string> grids = {
+        "..3.2.6..9..3.5..1..18.64....81.29..7.......8..67.82....26.95..8..2.3..9..5.1.3..",
+        "..39.....4...8..36..8...1...4..6..738......1......2.....4.7..686........7.....5..",
+        "........8..3...4...9..2..6.....79.......612...6.5.2.7...8...5...1.....2.4.5.....3",
+        "11" + std::string(79, '.'),
+        "1.....3..2.....4",
+        "12345"
+    };
+
+    for (auto undo : { sudoku::Undo::Snapshot, sudoku::Undo::Trail }) {
+        sudoku::Options opts;
+        opts.undo = undo;
+
+        // one step at a time, round robin over all the puzzles
+        std::vector<sudoku::ResumableSolve> solves;
+        for (auto& g : grids) solves.emplace_back(g, opts);
+        unsigned rounds = 0;
+        for (bool busy = true; busy; ++rounds) {
+            busy = false;
+            for (auto& s : solves) busy |= !s.step(1);
+        }
+        EXPECT_TRUE((rounds > 10));
+
+        const auto expected = sudoku::solve_batch(grids, opts);
+        for (std::size_t i = 0; i < grids.size(); ++i) {
+            EXPECT_TRUE(solves[i].done());
+            EXPECT_TRUE((solves[i].result().status == expected[i].status));
+            EXPECT_TRUE((solves[i].result().solution == expected[i].solution));
+            EXPECT_EQ(solves[i].result().stats.guesses, expected[i].stats.guesses);
+            EXPECT_TRUE((solves[i].result().stats.rule_calls == expected[i].stats.rule_calls));
+        }
+    }
+
+    // other engines finish in the first step
+    sudoku::Options recurse;
+    recurse.engine = sudoku::Engine::Recurse;
+    sudoku::ResumableSolve r(grids[1], recurse);
+    EXPECT_FALSE(r.done());
+    EXPECT_TRUE(r.step(1));
+    EXPECT_TRUE((r.result().status == sudoku::Status::Solved));
+
+    sudoku::ResumableSolve bad("12345");
+    EXPECT_TRUE(bad.done());
+    EXPECT_TRUE((bad.result().status == sudoku::Status::InvalidInput));
+}
+
+namespace {
+
+// Counts what is allocated through it, passing everything on to the default resource
+class CountingResource : public std::pmr::memory_resource {
+public:
+    std::size_t allocations = 0;
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t align) override {
+        ++allocations;
+        return std::pmr::get_default_resource()->allocate(bytes, align);
+    }
+    void do_deallocate(void* p, std::size_t bytes, std::size_t align) override {
+        std::pmr::get_default_resource()->deallocate(p, bytes, align);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
+
+}
+
+TEST(Api_MemoryResource) {
+    const std::vector<std::string> grids = {
+        "..39.....4...8..36..8...1...4..6..738......1......2.....4.7..686........7.....5..",
+        "........8..3...4...9..2..6.....79.......612...6.5.2.7...8...5...1.....2.4.5.....3"
+    };
+
+    for (auto undo : { sudoku::Undo::Snapshot, sudoku::Undo::Trail }) {
+        CountingResource counting;
+        std::pmr::unsynchronized_pool_resource pool(&counting);
+        sudoku::Options opts;
+        opts.undo = undo;
+        const auto expected = sudoku::solve_batch(grids, opts);
+
+        opts.memory = &pool;
+        for (std::size_t i = 0; i < grids.size(); ++i) {
+            const auto r = sudoku::solve(grids[i], opts);
+            EXPECT_TRUE((r.status == expected[i].status));
+            EXPECT_TRUE((r.solution == expected[i].solution));
+            EXPECT_EQ(r.stats.guesses, expected[i].stats.guesses);
+        }
+        EXPECT_TRUE((counting.allocations > 0));
+
+        // the pool keeps its blocks, so solving again needs nothing new from upstream
+        const std::size_t before = counting.allocations;
+        for (auto& g : grids) sudoku::solve(g, opts);
+        EXPECT_EQ(counting.allocations, before);
+    }
+}
@@ -0,0 +1,70 @@
+#include "test_macros.h"
+#include "../BatchStats.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+TEST(BatchStats_TopK) {
+    std::mt19937 rng(3);
+    std::vector<double> keys(1000);
+    for (auto& k : keys) k = static_cast<double>(rng() % 200);
+
+    TopK all(10), a(10), b(10);
+    for (int i = 0; i < (int)keys.size(); ++i) {
+        all.offer(keys[i], i);
+        (i % 3 == 0 ? a : b).offer(keys[i], i);
+    }
+    a.merge(b);
+
+    std::vector<double> expected = keys;
+    std::sort(expected.begin(), expected.end(), std::greater<double>());
+
+    const auto top = all.sorted();
+    const auto merged = a.sorted();
+    EXPECT_EQ(10u, top.size());
+    EXPECT_EQ(10u, merged.size());
+    for (std::size_t i = 0; i < top.size(); ++i) {
+        EXPECT_EQ(expected[i], top[i].key);
+        EXPECT_EQ(keys[top[i].index], top[i].key);
+        EXPECT_EQ(top[i].index, merged[i].index);
+    }
+
+    TopK small(3);
+    small.offer(1.0, 0);
+    EXPECT_EQ(1u, small.sorted().size());
+}
+
+TEST(BatchStats_Merge) {
+    auto make = [](sudoku::Status status, double ms, unsigned guesses) {
+        sudoku::Result r;
+        r.status = status;
+        r.stats.elapsed_ms = ms;
+        r.stats.guesses = guesses;
+        r.stats.rule_calls[0] = 1;
+        return r;
+    };
+
+    BatchStats s1, s2;
+    s1.add(0, make(sudoku::Status::Solved, 2.0, 0));
+    s2.add(1, make(sudoku::Status::Solved, 5.0, 7));
+    s1.add(2, make(sudoku::Status::Timeout, 9.0, 3));
+    s2.add(3, make(sudoku::Status::NoSolution, 1.0, 1));
+    s1.merge(s2);
+
+    EXPECT_EQ(4u, s1.count);
+    EXPECT_EQ(2u, s1.solved);
+    EXPECT_EQ(1u, s1.no_guess_solves);
+    EXPECT_EQ(7u, s1.max_guesses);
+    EXPECT_EQ(7.0, s1.total_time);
+    EXPECT_EQ(2.0, s1.min_time);
+    EXPECT_EQ(5.0, s1.max_time);
+    EXPECT_EQ(4u, s1.totals.rule_calls[0]);
+
+    EXPECT_EQ(2u, s1.failures.size());
+    EXPECT_EQ(2, s1.failures[0].index);
+    EXPECT_EQ(3, s1.failures[1].index);
+    EXPECT_TRUE((s1.failures[0].status == sudoku::Status::Timeout));
+
+    EXPECT_EQ(2, s1.by_time.sorted().front().index);
+    EXPECT_EQ(1, s1.by_guesses.sorted().front().index);
+}
@@ -0,0 +1,103 @@
+#include "test_macros.h"
+#include "solution_checks.h"
+#include "../Canonical.h"
+#include "../SolutionCache.h"
+#include <algorithm>
+#include <random>
+#include <string>
+
+namespace {
+
+std::string random_variant(const std::string& p, std::mt19937& rng) {
+    // apply a random element of the symmetry group
+    auto shuffled = [&rng](unsigned n) {
+        std::vector<unsigned> v(n);
+        for (unsigned i = 0; i < n; ++i) v[i] = i;
+        std::shuffle(v.begin(), v.end(), rng);
+        return v;
+    };
+
+    std::vector<unsigned> rows, cols;
+    const auto bands = shuffled(3);
+    const auto stacks = shuffled(3);
+    for (unsigned b = 0; b < 3; ++b) {
+        const auto r = shuffled(3);
+        const auto c = shuffled(3);
+        for (unsigned k = 0; k < 3; ++k) {
+            rows.push_back(3 * bands[b] + r[k]);
+            cols.push_back(3 * stacks[b] + c[k]);
+        }
+    }
+    const auto digits = shuffled(9);
+    const bool transpose = rng() % 2 == 1;
+
+    std::string out(81, '.');
+    for (unsigned r = 0; r < 9; ++r) {
+        for (unsigned c = 0; c < 9; ++c) {
+            const char ch = transpose ? p[9 * cols[c] + rows[r]] : p[9 * rows[r] + cols[c]];
+            if (ch >= '1' && ch <= '9') out[9 * r + c] = char('1' + digits[ch - '1']);
+        }
+    }
+    return out;
+}
+
+}
+
+TEST(Canonical_Invariant) {
+    const std::vector<std::string> puzzles = {
+        "1.......2..34...5..6....7.....85..9....3.6.....8.9.....2....1..7.......6..9.8..3.",
+        "........8..3...4...9..2..6.....79.......612...6.5.2.7...8...5...1.....2.4.5.....3",
+        "...........1...2.3..4.5.......6.....7.3...8.9....4....5.......1.....6..7..2..8..."
+    };
+    std::mt19937 rng(7);
+
+    for (auto& p : puzzles) {
+        CanonicalForm base;
+        EXPECT_TRUE(canonicalize(p, base));
+        EXPECT_TRUE((from_canonical(base.grid, base.transform) == p));
+
+        for (int i = 0; i < 10; ++i) {
+            const std::string v = random_variant(p, rng);
+            CanonicalForm form;
+            EXPECT_TRUE(canonicalize(v, form));
+            EXPECT_TRUE((form.grid == base.grid));
+            EXPECT_TRUE((to_canonical(v, form.transform) == form.grid));
+            EXPECT_TRUE((from_canonical(form.grid, form.transform) == v));
+        }
+    }
+
+    // different puzzles keep different forms
+    CanonicalForm a, b;
+    canonicalize(puzzles[0], a);
+    canonicalize(puzzles[1], b);
+    EXPECT_FALSE((a.grid == b.grid));
+
+    CanonicalForm empty;
+    EXPECT_FALSE(canonicalize(std::string(81, '.'), empty));
+    EXPECT_FALSE(canonicalize("123", empty));
+}
+
+TEST(Canonical_SolutionCache) {
+    const std::string p = "1.......2..34...5..6....7.....85..9....3.6.....8.9.....2....1..7.......6..9.8..3.";
+    SolutionCache cache(8, 2);
+    std::mt19937 rng(11);
+
+    const auto first = solve_cached(p, cache);
+    EXPECT_TRUE((first.status == sudoku::Status::Solved));
+    EXPECT_FALSE(first.stats.cache_hit);
+    EXPECT_EQ(1u, cache.size());
+
+    for (int i = 0; i < 5; ++i) {
+        const std::string v = random_variant(p, rng);
+        const auto r = solve_cached(v, cache);
+        EXPECT_TRUE(r.stats.cache_hit);
+        EXPECT_TRUE(is_valid_solution(v, r.solution));
+    }
+    EXPECT_EQ(5u, cache.hits());
+
+    // bounded: old entries are evicted
+    for (unsigned k = 0; k < 40; ++k) {
+        cache.insert(std::string(80, '.') + char('0' + k % 10) + std::to_string(k), "x");
+    }
+    EXPECT_TRUE((cache.size() <= 8));
+}
@@ -0,0 +1,123 @@
+#include "test_macros.h"
+#include "../Checkpoint.h"
+#include "../ResultWriter.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+PuzzleArchive make_archive(const std::vector<std::string>& grids) {
+    PuzzleArchive a;
+    for (auto& g : grids) a.add(g);
+    return a;
+}
+
+std::string read_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+}
+
+TEST(Checkpoint_RoundTrip) {
+    BatchStats stats(3);
+    for (int i = 0; i < 6; ++i) {
+        sudoku::Result r;
+        r.status = i == 4 ? sudoku::Status::Timeout : sudoku::Status::Solved;
+        r.stats.elapsed_ms = 0.1 * (i + 1) / 3.0;
+        r.stats.guesses = i * 2;
+        r.stats.undo_bytes = 1000 + i;
+        r.stats.rule_calls[2] = i + 1;
+        r.stats.rule_applies[4] = i;
+        stats.add(i, r);
+    }
+
+    Checkpoint cp;
+    cp.num_puzzles = 10;
+    cp.fingerprint = batch_fingerprint(make_archive({ "1...", "..2." }));
+    cp.next_index = 6;
+    cp.output_bytes = 1234;
+    cp.stats = stats;
+
+    const std::string path = (std::filesystem::temp_directory_path() / "sudoku_checkpoint_test.txt").string();
+    std::filesystem::remove(path);
+    Checkpoint loaded;
+    EXPECT_FALSE(load_checkpoint(path, loaded));
+
+    save_checkpoint(path, cp);
+    EXPECT_TRUE(load_checkpoint(path, loaded));
+    EXPECT_EQ(cp.num_puzzles, loaded.num_puzzles);
+    EXPECT_EQ(cp.fingerprint, loaded.fingerprint);
+    EXPECT_EQ(cp.next_index, loaded.next_index);
+    EXPECT_EQ(cp.output_bytes, loaded.output_bytes);
+
+    // saving the loaded stats again gives the same text, so nothing was rounded
+    std::ostringstream a, b;
+    stats.save(a);
+    loaded.stats.save(b);
+    EXPECT_TRUE((a.str() == b.str()));
+    EXPECT_EQ(stats.total_time, loaded.stats.total_time);
+    EXPECT_EQ(1u, loaded.stats.failures.size());
+    EXPECT_EQ(3u, loaded.stats.by_time.sorted().size());
+    EXPECT_EQ(5, loaded.stats.by_guesses.sorted().front().index);
+
+    // the line breaks between puzzles count
+    EXPECT_TRUE((batch_fingerprint(make_archive({ "1...", "..2." })) != batch_fingerprint(make_archive({ "1....", ".2." }))));
+
+    std::ofstream(path) << "count 3\n";
+    EXPECT_ANY_THROW(load_checkpoint(path, loaded));
+
+    // a checkpoint from an older format is refused before its fields are read
+    std::ofstream(path) << "sudoku-checkpoint 1\nnum_puzzles 10\n";
+    EXPECT_ANY_THROW(load_checkpoint(path, loaded));
+    std::filesystem::remove(path);
+
+    // a checkpoint that can't be written is an error, not a silent skip
+    const auto missing = std::filesystem::temp_directory_path() / "sudoku_no_such_dir" / "cp";
+    EXPECT_ANY_THROW(save_checkpoint(missing.string(), cp));
+}
+
+TEST(Checkpoint_ResumeResults) {
+    const std::vector<std::string> grids = {
+        "1.......2..34...5..6....7.....85..9....3.6.....8.9.....2....1..7.......6..9.8..3.",
+        "........8..3...4...9..2..6.....79.......612...6.5.2.7...8...5...1.....2.4.5.....3",
+        "........2..8.1.9..5....3.4....1.93...6..3..8...37......4......53.1.7.8..2........"
+    };
+    const std::string path = (std::filesystem::temp_directory_path() / "sudoku_checkpoint_test.csv").string();
+
+    std::vector<sudoku::Result> results;
+    for (auto& g : grids) results.push_back(sudoku::solve(g));
+
+    std::string expected;
+    {
+        ResultWriter w(path, ResultWriter::Format::Csv);
+        for (std::size_t i = 0; i < grids.size(); ++i) w.write(grids[i], results[i]);
+    }
+    expected = read_file(path);
+
+    // a run that synced after the first puzzle, then wrote part of the next chunk before dying
+    std::uint64_t synced = 0;
+    {
+        ResultWriter w(path, ResultWriter::Format::Csv);
+        w.write(grids[0], results[0]);
+        synced = w.sync();
+        EXPECT_EQ(synced, read_file(path).size());
+        w.write(grids[1], results[1]);
+    }
+
+    {
+        ResultWriter w(path, ResultWriter::Format::Csv, ResultWriter::default_flush_bytes, synced);
+        w.write(grids[1], results[1]);
+        w.write(grids[2], results[2]);
+        EXPECT_EQ(expected.size(), w.sync());
+    }
+    EXPECT_TRUE((read_file(path) == expected));
+
+    EXPECT_ANY_THROW(ResultWriter(path, ResultWriter::Format::Csv, ResultWriter::default_flush_bytes, expected.size() + 1));
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,225 @@
+#include "test_macros.h"
+#include "solution_checks.h"
+#include "../SolutionCache.h"
+#include "../sudoku.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct EngineConfig {
+    std::string name;
+    sudoku::Options options;
+    bool batch; // run through solve_batch() instead of solve()
+};
+
+std::vector<EngineConfig> engines() {
+    std::vector<EngineConfig> e;
+    for (auto b : { sudoku::Branching::Mrv, sudoku::Branching::UnitDigit, sudoku::Branching::Degree, sudoku::Branching::Frequency }) {
+        for (auto u : { sudoku::Undo::Snapshot, sudoku::Undo::Trail }) {
+            sudoku::Options o;
+            o.branching = b;
+            o.undo = u;
+            e.push_back({ std::string("rules/") + sudoku::branching_name(b) + (u == sudoku::Undo::Trail ? "/trail" : ""), o, false });
+        }
+    }
+
+    for (auto rs : { sudoku::RuleSet::Singles, sudoku::RuleSet::Subsets }) {
+        sudoku::Options o;
+        o.rules = rs;
+        e.push_back({ rs == sudoku::RuleSet::Singles ? "rules/singles" : "rules/subsets", o, false });
+    }
+
+    sudoku::Options o;
+    o.engine = sudoku::Engine::Recurse;
+    e.push_back({ "recurse", o, false });
+
+    o = sudoku::Options();
+    o.engine = sudoku::Engine::Lanes;
+    e.push_back({ "lanes", o, true });
+
+    o = sudoku::Options();
+    o.threads = 3;
+    e.push_back({ "parallel", o, false });
+    return e;
+}
+
+// random full grid: a shuffled first row, completed by the solver
+std::string random_solution(std::mt19937& rng) {
+    std::string row = "123456789";
+    std::shuffle(row.begin(), row.end(), rng);
+    return sudoku::solve(row + std::string(72, '.')).solution;
+}
+
+// keep `givens` random cells of a solution
+std::string make_puzzle(const std::string& solution, unsigned givens, std::mt19937& rng) {
+    std::vector<unsigned> cells(81);
+    for (unsigned i = 0; i < 81; ++i) cells[i] = i;
+    std::shuffle(cells.begin(), cells.end(), rng);
+
+    std::string p(81, '.');
+    for (unsigned k = 0; k < givens; ++k) p[cells[k]] = solution[cells[k]];
+    return p;
+}
+
+}
+
+TEST(Differential_Engines) {
+    std::mt19937 rng(2024);
+    std::vector<std::string> puzzles;
+
+    for (int i = 0; i < 30; ++i) {
+        const std::string s = random_solution(rng);
+        // from many solutions (few givens) to a unique one
+        puzzles.push_back(make_puzzle(s, 17 + rng() % 30, rng));
+    }
+    for (int i = 0; i < 10; ++i) {
+        // a wrong given makes most of these unsolvable
+        std::string p = make_puzzle(random_solution(rng), 25 + rng() % 20, rng);
+        const unsigned c = rng() % 81;
+        p[c] = char('1' + (rng() % 9));
+        puzzles.push_back(p);
+    }
+
+    const auto configs = engines();
+    std::vector<std::vector<sudoku::Result>> results;
+    for (auto& e : configs) {
+        if (e.batch) {
+            results.push_back(sudoku::solve_batch(puzzles, e.options));
+            continue;
+        }
+        std::vector<sudoku::Result> rs;
+        for (auto& p : puzzles) rs.push_back(sudoku::solve(p, e.options));
+        results.push_back(rs);
+    }
+
+    SolutionCache cache(64);
+    unsigned unique = 0, multiple = 0, none = 0;
+
+    for (std::size_t i = 0; i < puzzles.size(); ++i) {
+        const unsigned count = sudoku::count_solutions(puzzles[i], 2);
+        if (count == 0) ++none;
+        else if (count == 1) ++unique;
+        else ++multiple;
+
+        const auto reference = results[0][i];
+        for (std::size_t e = 0; e < configs.size(); ++e) {
+            const auto& r = results[e][i];
+            const bool agrees = (count > 0) == (r.status == sudoku::Status::Solved)
+                && (count > 0 || r.status == sudoku::Status::NoSolution);
+            if (!agrees) std::cout << configs[e].name << " disagrees on " << puzzles[i] << std::endl;
+            EXPECT_TRUE(agrees);
+
+            if (r.status == sudoku::Status::Solved) {
+                EXPECT_TRUE(is_valid_solution(puzzles[i], r.solution));
+                if (count == 1) EXPECT_TRUE((r.solution == reference.solution));
+            }
+        }
+
+        // the cache answers the same puzzle and its transpose consistently
+        std::string t(81, '.');
+        for (unsigned c = 0; c < 81; ++c) t[9 * (c % 9) + c / 9] = puzzles[i][c];
+        for (auto& g : { puzzles[i], t }) {
+            const auto r = solve_cached(g, cache);
+            EXPECT_TRUE(((r.status == sudoku::Status::Solved) == (count > 0)));
+            if (r.status == sudoku::Status::Solved) EXPECT_TRUE(is_valid_solution(g, r.solution));
+        }
+    }
+
+    // the generator should cover all three kinds
+    EXPECT_TRUE((unique > 0 && multiple > 0 && none > 0));
+}
+
+TEST(Differential_CountSolutions) {
+    EXPECT_EQ(1u, sudoku::count_solutions("..39.....4...8..36..8...1...4..6..738......1......2.....4.7..686........7.....5.."));
+    EXPECT_EQ(2u, sudoku::count_solutions(std::string(81, '.')));
+    EXPECT_EQ(5u, sudoku::count_solutions(std::string(16, '.'), 5));
+    EXPECT_EQ(0u, sudoku::count_solutions("11" + std::string(79, '.')));
+    EXPECT_EQ(0u, sudoku::count_solutions("123"));
+}
+
+TEST(Differential_Minimality) {
+    // against the definition: each clue taken away in turn, solutions counted to 2
+    std::mt19937 rng(49);
+    std::vector<std::string> puzzles = {
+        "..39.....4...8..36..8...1...4..6..738......1......2.....4.7..686........7.....5..",
+        "1.....3..2.....4",
+        std::string(81, '.'),
+        "11" + std::string(79, '.')
+    };
+    for (int i = 0; i < 12; ++i) puzzles.push_back(make_puzzle(random_solution(rng), 32 + rng() % 20, rng));
+
+    unsigned unique = 0, minimal = 0;
+    for (const auto& p : puzzles) {
+        std::vector<unsigned> expected;
+        if (sudoku::count_solutions(p, 2) == 1) {
+            ++unique;
+            for (unsigned c = 0; c < p.size(); ++c) {
+                if (p[c] == '.') continue;
+                std::string q = p;
+                q[c] = '.';
+                if (sudoku::count_solutions(q, 2) == 1) expected.push_back(c);
+            }
+        }
+
+        for (unsigned threads : { 1u, 3u }) {
+            EXPECT_TRUE((sudoku::redundant_clues(p, threads) == expected));
+            EXPECT_EQ(sudoku::is_minimal(p, threads), (sudoku::count_solutions(p, 2) == 1 && expected.empty()));
+        }
+        if (sudoku::count_solutions(p, 2) == 1 && expected.empty()) ++minimal;
+
+        // minimize() keeps the solution, only removes clues, and leaves nothing redundant
+        const std::string m = sudoku::minimize(p, 2);
+        if (sudoku::count_solutions(p, 2) != 1) {
+            EXPECT_EQ(m, p);
+            continue;
+        }
+        EXPECT_TRUE(sudoku::is_minimal(m));
+        EXPECT_EQ(sudoku::solve(m).solution, sudoku::solve(p).solution);
+        bool subset = true;
+        for (unsigned c = 0; c < p.size(); ++c) subset &= m[c] == '.' || m[c] == p[c];
+        EXPECT_TRUE(subset);
+        if (expected.empty()) EXPECT_EQ(m, p);
+    }
+    EXPECT_TRUE((unique > 5 && unique > minimal));
+}
+
+TEST(Differential_TimeLimits) {
+    /*
+    Regression guard: on known hard puzzles no fast engine may take longer
+    than max_ms. Release builds need well under a tenth of this, so only
+    a real slowdown (or a hang) trips it. Debug and sanitizer builds still
+    check the results but not the times
+    */
+#if defined(NDEBUG) && !defined(SUDOKU_SANITIZED) && !defined(__SANITIZE_ADDRESS__) && !defined(__SANITIZE_THREAD__)
+    constexpr bool check_times = true;
+#else
+    constexpr bool check_times = false;
+#endif
+    constexpr double max_ms = 1000.0;
+    const std::vector<std::string> hardest = {
+        "..39.....4...8..36..8...1...4..6..738......1......2.....4.7..686........7.....5..",
+        "1....6.8....7..1....9.....4.......5..18..5...5..36.8..6.5..8.3.8....3.1.....2....",
+        "....9..5..1.....3...23..7....45...7.8.....2.......64...9..1.....8..6......54....7",
+        "................12..3..4..5.....6.......7.3..128..........2......9...4...6.15....",
+        ".2.4...8...7.....3.8.237.1.2.1....9..9....8.4...9......1.8...4.5.8..........6...."
+    };
+
+    for (auto& e : engines()) {
+        if (e.options.engine == sudoku::Engine::Recurse) continue;
+        for (auto& p : hardest) {
+            const auto start = std::chrono::steady_clock::now();
+            const auto r = sudoku::solve(p, e.options);
+            const auto end = std::chrono::steady_clock::now();
+            const double ms = 1e-3 * std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+            EXPECT_TRUE((r.status == sudoku::Status::Solved));
+            if (!check_times) continue;
+            if (ms > max_ms) std::cout << e.name << " took " << ms << " ms on " << p << std::endl;
+            EXPECT_TRUE((ms <= max_ms));
+        }
+    }
+}
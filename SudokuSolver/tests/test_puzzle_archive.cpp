@@ -0,0 +1,71 @@
+#include "test_macros.h"
+#include "../PuzzleArchive.h"
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(PuzzleArchive_Pack) {
+    const std::string grid = "1.......2..34...5..6....7.....85..9....3.6.....8.9.....2....1..7.......6..9.8..3.";
+    const std::string solved = "812753649943682175675491283154237896369845721287169534521974368438526917796318452";
+
+    EXPECT_EQ(41u, sizeof(PackedGrid));
+    EXPECT_TRUE((PackedGrid::pack(grid).unpack() == grid));
+    EXPECT_TRUE((PackedGrid::pack(solved).unpack() == solved));
+    EXPECT_FALSE(PackedGrid::pack(solved).is_overflow());
+
+    // other empty-cell characters come back as '.'
+    std::string zeros = grid;
+    for (auto& c : zeros) if (c == '.') c = '0';
+    EXPECT_TRUE((PackedGrid::pack(zeros).unpack() == grid));
+
+    const std::string small = "1.....3..2.....4";
+    PuzzleArchive a;
+    a.add(solved);
+    a.add(small);
+    a.add(grid);
+    a.add(small + "x");
+    EXPECT_EQ(4u, a.size());
+    EXPECT_TRUE((a[0] == solved));
+    EXPECT_TRUE((a[1] == small));
+    EXPECT_TRUE((a[2] == grid));
+    EXPECT_TRUE((a[3] == small + "x"));
+
+    a.sort();
+    EXPECT_TRUE((a[0] == small));
+    EXPECT_TRUE((a[1] == small + "x"));
+    EXPECT_TRUE((a[2] == grid));
+    EXPECT_TRUE((a[3] == solved));
+}
+
+TEST(PuzzleArchive_ResultTable) {
+    const std::vector<std::string> grids = {
+        "1.......2..34...5..6....7.....85..9....3.6.....8.9.....2....1..7.......6..9.8..3.",
+        "11" + std::string(79, '.'),
+        "1.....3..2.....4",
+        "........8..3...4...9..2..6.....79.......612...6.5.2.7...8...5...1.....2.4.5.....3"
+    };
+
+    std::vector<sudoku::Result> expected;
+    for (auto& g : grids) expected.push_back(sudoku::solve(g));
+    expected[3].stats.cache_hit = true;
+
+    ResultTable table(grids.size());
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < grids.size(); ++i) {
+        threads.emplace_back([&, i] { table.set(i, expected[i]); });
+    }
+    for (auto& t : threads) t.join();
+
+    for (std::size_t i = 0; i < grids.size(); ++i) {
+        const auto r = table.get(i);
+        EXPECT_TRUE((r.status == expected[i].status));
+        EXPECT_TRUE((r.solution == expected[i].solution));
+        EXPECT_EQ(expected[i].stats.elapsed_ms, r.stats.elapsed_ms);
+        EXPECT_EQ(expected[i].stats.guesses, r.stats.guesses);
+        EXPECT_EQ(expected[i].stats.undo_bytes, r.stats.undo_bytes);
+        EXPECT_EQ(expected[i].stats.cache_hit, r.stats.cache_hit);
+        EXPECT_TRUE((r.stats.rule_calls == expected[i].stats.rule_calls));
+        EXPECT_TRUE((r.stats.rule_applies == expected[i].stats.rule_applies));
+    }
+    EXPECT_TRUE((table.get(1).solution.empty()));
+}
@@ -0,0 +1,100 @@
+#include "test_macros.h"
+#include "../ResultWriter.h"
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::vector<std::string> read_lines(const std::string& path) {
+    std::vector<std::string> lines;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) lines.push_back(line);
+    return lines;
+}
+
+}
+
+TEST(ResultWriter_Formats) {
+    const std::string grid = "1.......2..34...5..6....7.....85..9....3.6.....8.9.....2....1..7.......6..9.8..3.";
+    const auto r = sudoku::solve(grid);
+
+    const auto dir = std::filesystem::temp_directory_path();
+    const std::string csv = (dir / "sudoku_writer_test.csv").string();
+    const std::string jsonl = (dir / "sudoku_writer_test.jsonl").string();
+
+    EXPECT_TRUE((ResultWriter::format_for(csv) == ResultWriter::Format::Csv));
+    EXPECT_TRUE((ResultWriter::format_for(jsonl) == ResultWriter::Format::Jsonl));
+
+    {
+        ResultWriter w(csv, ResultWriter::Format::Csv);
+        w.write(grid, r);
+    }
+    {
+        ResultWriter w(jsonl, ResultWriter::Format::Jsonl);
+        w.write(grid, r);
+    }
+
+    auto lines = read_lines(csv);
+    EXPECT_EQ(2u, lines.size());
+    if (lines.size() == 2) {
+        EXPECT_TRUE((lines[0].rfind("puzzle,status,solution,time_ms,guesses,rule1_calls", 0) == 0));
+        EXPECT_TRUE((lines[1].rfind(grid + ",solved," + r.solution + ",", 0) == 0));
+    }
+
+    lines = read_lines(jsonl);
+    EXPECT_EQ(1u, lines.size());
+    if (lines.size() == 1) {
+        EXPECT_TRUE((lines[0].rfind("{\"puzzle\":\"" + grid + "\",\"status\":\"solved\",\"solution\":\"" + r.solution + "\"", 0) == 0));
+        EXPECT_TRUE((lines[0].find("\"rule_calls\":[") != std::string::npos));
+    }
+
+    std::filesystem::remove(csv);
+    std::filesystem::remove(jsonl);
+}
+
+TEST(ResultWriter_ConcurrentWrites) {
+    const std::string path = (std::filesystem::temp_directory_path() / "sudoku_writer_threads.jsonl").string();
+    sudoku::Result r;
+    r.status = sudoku::Status::NoSolution;
+
+    {
+        // small flush size so the background thread writes while records are still coming in
+        ResultWriter w(path, ResultWriter::Format::Jsonl, 512);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&w, &r] {
+                for (int i = 0; i < 250; ++i) w.write("puzzle", r);
+            });
+        }
+        for (auto& t : threads) t.join();
+    }
+
+    const auto lines = read_lines(path);
+    EXPECT_EQ(1000u, lines.size());
+    bool all_complete = true;
+    for (auto& l : lines) {
+        if (l.rfind("{\"puzzle\":\"puzzle\",\"status\":\"no_solution\"", 0) != 0 || l.back() != '}') all_complete = false;
+    }
+    EXPECT_TRUE(all_complete);
+
+    std::filesystem::remove(path);
+}
+
+TEST(ResultWriter_ReportsFailedWrites) {
+    const std::string grid = "1.......2..34...5..6....7.....85..9....3.6.....8.9.....2....1..7.......6..9.8..3.";
+    const auto missing = std::filesystem::temp_directory_path() / "sudoku_no_such_dir" / "out.csv";
+    EXPECT_ANY_THROW(ResultWriter(missing.string(), ResultWriter::Format::Csv));
+
+    // every write to /dev/full fails with no space left
+    if (!std::filesystem::exists("/dev/full")) return;
+    ResultWriter w("/dev/full", ResultWriter::Format::Csv);
+    const auto r = sudoku::solve(grid);
+    for (int i = 0; i < 100; ++i) w.write(grid, r);
+    EXPECT_ANY_THROW(w.sync());
+    EXPECT_FALSE(w.close());
+    EXPECT_FALSE(w.close());
+}
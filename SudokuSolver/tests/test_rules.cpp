@@ -0,0 +1,49 @@
+#include "test_macros.h"
+#include "../Puzzle.h"
+#include <string>
+
+TEST(Rules_NakedSingles) {
+    // every empty cell has one option left after eliminating the givens
+    const std::string solved = "534678912672195348198342567859761423426853791713924856961537284287419635345286179";
+    std::string grid = solved;
+    for (unsigned i : { 0u, 10u, 20u, 40u, 60u, 80u }) grid[i] = '.';
+
+    Puzzle p(grid);
+    EXPECT_TRUE((p.propagate() == sudoku::Status::Solved));
+    EXPECT_TRUE((p.solution() == solved));
+    EXPECT_EQ(0, p.num_guesses());
+}
+
+TEST(Rules_PropagateStopsForGuess) {
+    Puzzle p(std::string(81, '.'));
+    EXPECT_TRUE((p.propagate() == sudoku::Status::Unsolved));
+    EXPECT_TRUE((p.guess_cell() >= 0));
+
+    // a repeated given is a contradiction, found without guessing
+    Puzzle bad("1.......1" + std::string(72, '.'));
+    EXPECT_TRUE((bad.propagate() == sudoku::Status::NoSolution));
+}
+
+TEST(Rules_Pipelines) {
+    const std::string grid = "..39.....4...8..36..8...1...4..6..738......1......2.....4.7..686........7.....5..";
+    Puzzle full(grid);
+    full.solve();
+
+    for (auto rs : { sudoku::RuleSet::Singles, sudoku::RuleSet::Subsets }) {
+        Puzzle p(grid);
+        p.set_rules(rs);
+        p.solve();
+        EXPECT_TRUE(p.solved());
+        EXPECT_TRUE((p.solution() == full.solution()));
+
+        // rules outside the pipeline are compiled out, so never called
+        const auto st = p.stats();
+        EXPECT_TRUE((st.rule_calls[1] > 0));
+        EXPECT_EQ(0u, st.rule_calls[4]);
+        if (rs == sudoku::RuleSet::Singles) {
+            EXPECT_EQ(0u, st.rule_calls[2]);
+            EXPECT_EQ(0u, st.rule_calls[3]);
+        }
+    }
+    EXPECT_TRUE((full.stats().rule_calls[4] > 0));
+}
@@ -0,0 +1,119 @@
+#include "test_macros.h"
+#include "../Server.h"
+#include "../SolverPool.h"
+#include <atomic>
+#include <filesystem>
+#include <set>
+#include <string>
+#include <thread>
+
+TEST(Server_LatencyHistogram) {
+    LatencyHistogram h;
+    for (std::uint64_t us = 1; us <= 1000; ++us) h.record(us);
+
+    EXPECT_EQ(1000u, h.count());
+    EXPECT_EQ(1000u, h.max());
+    EXPECT_TRUE((h.mean() > 500.0 && h.mean() < 501.0));
+
+    // percentiles are bucket upper bounds, within 12.5% of the true value
+    const auto p50 = h.percentile(50);
+    const auto p99 = h.percentile(99);
+    EXPECT_TRUE((p50 >= 500 && p50 <= 563));
+    EXPECT_TRUE((p99 >= 990 && p99 <= 1000));
+    EXPECT_EQ(1u, h.percentile(0));
+}
+
+TEST(Server_PoolBackpressure) {
+    SolverPool pool(2, 4, 2);
+    std::atomic<int> done{ 0 };
+    const std::string grid = "1.......2..34...5..6....7.....85..9....3.6.....8.9.....2....1..7.......6..9.8..3.";
+
+    for (int i = 0; i < 50; ++i) {
+        pool.submit(grid, [&done](const std::string&, const sudoku::Result& r) {
+            if (r.status == sudoku::Status::Solved) ++done;
+        });
+        EXPECT_TRUE((pool.queue_depth() <= pool.capacity()));
+    }
+    pool.shutdown();
+
+    EXPECT_EQ(50, done.load());
+    EXPECT_FALSE(pool.try_submit(grid, nullptr));
+}
+
+TEST(Server_LocalClient) {
+    const std::string path = (std::filesystem::temp_directory_path() / "sudoku_server_test.sock").string();
+    const std::string grid = "1.......2..34...5..6....7.....85..9....3.6.....8.9.....2....1..7.......6..9.8..3.";
+    const auto expected = sudoku::solve(grid);
+
+    ServerConfig cfg;
+    cfg.threads = 2;
+    cfg.max_in_flight = 2; // exercise the per-connection backpressure
+    Server server(path, cfg);
+    server.start();
+
+    {
+        ServerClient client(path);
+        for (int i = 0; i < 5; ++i) client.send_line(grid);
+        client.send_line("12345");
+        client.send_line("QUIT");
+
+        std::set<std::string> ids;
+        int solved = 0;
+        int invalid = 0;
+        std::string line;
+        while (client.read_line(line)) {
+            ids.insert(line.substr(0, line.find(',')));
+            if (line.find("\"solution\":\"" + expected.solution + "\"") != std::string::npos) ++solved;
+            if (line.find("\"status\":\"invalid_input\"") != std::string::npos) ++invalid;
+            EXPECT_TRUE((line.find("\"latency_us\":") != std::string::npos));
+        }
+
+        EXPECT_EQ(6u, ids.size());
+        EXPECT_EQ(5, solved);
+        EXPECT_EQ(1, invalid);
+    }
+
+    {
+        ServerClient client(path);
+        client.send_line("STATS");
+        client.finish_sending();
+        std::string line;
+        EXPECT_TRUE(client.read_line(line));
+        EXPECT_TRUE((line.find("\"completed\":6") != std::string::npos));
+        EXPECT_TRUE((line.find("\"p99\":") != std::string::npos));
+    }
+
+    server.stop();
+    EXPECT_EQ(6u, server.latency().count());
+    EXPECT_FALSE(std::filesystem::exists(path));
+}
+
+TEST(Server_RejectsLongLine) {
+    const std::string path = (std::filesystem::temp_directory_path() / "sudoku_server_long.sock").string();
+    const std::string grid = "1.......2..34...5..6....7.....85..9....3.6.....8.9.....2....1..7.......6..9.8..3.";
+
+    ServerConfig cfg;
+    cfg.max_line_bytes = 1000;
+    Server server(path, cfg);
+    server.start();
+
+    {
+        // a line past the limit gets an error and the connection is closed,
+        // after the reply to the request before it
+        ServerClient client(path);
+        client.send_line(grid);
+        client.send_line(std::string(5000, 'x'));
+
+        int errors = 0;
+        int lines = 0;
+        std::string line;
+        while (client.read_line(line)) {
+            ++lines;
+            if (line == "{\"error\":\"line too long\"}") ++errors;
+        }
+        EXPECT_EQ(1, errors);
+        EXPECT_EQ(2, lines);
+    }
+
+    server.stop();
+}
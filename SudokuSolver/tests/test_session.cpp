@@ -0,0 +1,100 @@
+#include "test_macros.h"
+#include "../Session.h"
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+const std::string solution = "812753649943682175675491283154237896369845721287169534521974368438526917796318452";
+const std::string puzzle = "8..........36......7..9.2...5...7.......457.....1...3...1....68..85...1..9....4..";
+
+}
+
+TEST(Session_EditsMatchFreshSolve) {
+    Session s(puzzle);
+    EXPECT_TRUE((s.status() == sudoku::Status::Unsolved));
+    EXPECT_TRUE((s.solve().solution == solution));
+
+    std::mt19937 rng(5);
+    for (int step = 0; step < 200; ++step) {
+        const unsigned cell = rng() % 81;
+        if (rng() % 3 == 0) {
+            s.clear_given(cell);
+        }
+        else {
+            s.set_given(cell, unsigned(solution[cell] - '0'));
+        }
+
+        // every given comes from the solution, so the edited puzzle is always solvable
+        EXPECT_TRUE((s.status() != sudoku::Status::NoSolution));
+        const auto r = s.solve();
+        EXPECT_TRUE((r.status == sudoku::Status::Solved));
+
+        const auto fresh = sudoku::solve(s.givens());
+        if (sudoku::count_solutions(s.givens()) == 1) {
+            EXPECT_TRUE((r.solution == fresh.solution));
+        }
+
+        // the propagated board never contradicts the solution
+        const std::string board = s.board();
+        bool consistent = true;
+        for (unsigned i = 0; i < 81; ++i) {
+            if (board[i] != '.' && board[i] != solution[i]) consistent = false;
+        }
+        EXPECT_TRUE(consistent);
+    }
+}
+
+TEST(Session_RetractConflict) {
+    Session s(puzzle);
+    s.set_given(1, 1);
+    const std::string before = s.board();
+    const auto calls = s.stats().rule_calls[0];
+
+    // the first row already has an 8 in cell 0
+    EXPECT_TRUE((s.set_given(2, 8) == sudoku::Status::NoSolution));
+    EXPECT_TRUE((s.solve().status == sudoku::Status::NoSolution));
+
+    EXPECT_TRUE((s.clear_given(2) == sudoku::Status::Unsolved));
+    EXPECT_TRUE((s.board() == before));
+
+    // retracting an older edit replays the later ones
+    s.set_given(5, 3);
+    EXPECT_TRUE((s.stats().rule_calls[0] > calls));
+    s.clear_given(1);
+    EXPECT_TRUE((s.givens()[1] == '.'));
+    EXPECT_TRUE((s.givens()[5] == '3'));
+
+    // retracting an original given rebuilds the board
+    EXPECT_TRUE((s.clear_given(0) == sudoku::Status::Unsolved));
+    EXPECT_TRUE((s.givens()[0] == '.'));
+    EXPECT_TRUE((s.solve().status == sudoku::Status::Solved));
+
+    EXPECT_ANY_THROW(s.set_given(81, 1));
+    EXPECT_ANY_THROW(s.set_given(0, 10));
+    EXPECT_ANY_THROW(Session("123"));
+}
+
+TEST(Session_ConflictStaysUntilCleared) {
+    Session s(puzzle);
+    EXPECT_TRUE((s.set_given(2, 8) == sudoku::Status::NoSolution));
+
+    // later edits don't hide the conflicting given
+    EXPECT_TRUE((s.set_given(3, 7) == sudoku::Status::NoSolution));
+    EXPECT_TRUE((s.set_given(4, 5) == sudoku::Status::NoSolution));
+    EXPECT_TRUE((s.solve().status == sudoku::Status::NoSolution));
+    EXPECT_TRUE((sudoku::solve(s.givens()).status == sudoku::Status::NoSolution));
+
+    // nor does retracting an edit made before or after it
+    s.clear_given(4);
+    EXPECT_TRUE((s.status() == sudoku::Status::NoSolution));
+    s.set_given(4, 5);
+    s.clear_given(3);
+    EXPECT_TRUE((s.status() == sudoku::Status::NoSolution));
+
+    // clearing it puts the session back in step with a fresh solve
+    s.clear_given(2);
+    EXPECT_TRUE((s.status() != sudoku::Status::NoSolution));
+    EXPECT_TRUE((s.solve().status == sudoku::solve(s.givens()).status));
+}
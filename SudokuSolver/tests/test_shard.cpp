@@ -0,0 +1,196 @@
+#include "test_macros.h"
+#include "../Shard.h"
+#include "../ResultWriter.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+const std::vector<std::string> grids = {
+    "1.......2..34...5..6....7.....85..9....3.6.....8.9.....2....1..7.......6..9.8..3.",
+    "..3.2.6..9..3.5..1..18.64....81.29..7.......8..67.82....26.95..8..2.3..9..5.1.3..",
+    "..39.....4...8..36..8...1...4..6..738......1......2.....4.7..686........7.....5..",
+    "........8..3...4...9..2..6.....79.......612...6.5.2.7...8...5...1.....2.4.5.....3",
+    "...........1...2.3..4.5.......6.....7.3...8.9....4....5.......1.....6..7..2..8...",
+};
+
+std::string temp_path(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+// The five grids with a comment and a blank line mixed in
+std::string write_input(const std::string& name) {
+    const std::string path = temp_path(name);
+    std::ofstream out(path, std::ios::binary);
+    out << "# test puzzles\n" << grids[0] << "\n" << grids[1] << "\r\n\n";
+    for (std::size_t i = 2; i < grids.size(); ++i) out << grids[i] << "\n";
+    return path;
+}
+
+}
+
+TEST(Shard_SplitCoversEveryLineOnce) {
+    const std::string path = write_input("sudoku_shard_split.txt");
+    const auto size = std::filesystem::file_size(path);
+
+    for (unsigned count : { 1u, 2u, 3u, 7u, 50u, 1000u }) {
+        const auto shards = split_shards(path, count);
+        EXPECT_TRUE((!shards.empty() && shards.size() <= count));
+        EXPECT_EQ(shards.front().begin, 0u);
+        EXPECT_EQ(shards.back().end, size);
+
+        std::vector<std::string> seen;
+        for (std::size_t k = 0; k < shards.size(); ++k) {
+            if (k > 0) EXPECT_EQ(shards[k].begin, shards[k - 1].end);
+            const PuzzleArchive a = read_shard(shards[k]);
+            for (std::size_t i = 0; i < a.size(); ++i) seen.push_back(a[i]);
+        }
+        EXPECT_TRUE((seen == grids));
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(Shard_ResultRoundTrip) {
+    ShardResult r;
+    r.records = "a,b,c\n1,2,3\n";
+    for (int i = 0; i < 4; ++i) {
+        sudoku::Result s;
+        s.status = i == 2 ? sudoku::Status::Timeout : sudoku::Status::Solved;
+        s.stats.guesses = i;
+        s.stats.elapsed_ms = 0.25 * i;
+        r.stats.add(i, s);
+    }
+    r.puzzles[2] = grids[2];
+    r.puzzles[3] = grids[3];
+
+    std::ostringstream out;
+    write_shard_result(out, r);
+    const std::string data = out.str();
+
+    ShardResult back;
+    EXPECT_TRUE(read_shard_result(data, back));
+    EXPECT_EQ(back.records, r.records);
+    EXPECT_EQ(back.stats.count, 4u);
+    EXPECT_EQ(back.stats.solved, 3u);
+    EXPECT_EQ(back.stats.failures.size(), 1u);
+    EXPECT_TRUE((back.puzzles == r.puzzles));
+
+    // a reply cut short anywhere is rejected
+    for (std::size_t n = 0; n < data.size(); n += 7) {
+        ShardResult cut;
+        EXPECT_FALSE(read_shard_result(data.substr(0, n), cut));
+    }
+}
+
+TEST(Shard_ShiftIndices) {
+    BatchStats stats;
+    sudoku::Result s;
+    s.status = sudoku::Status::NoSolution;
+    stats.add(1, s);
+    stats.shift_indices(100);
+    EXPECT_EQ(stats.failures.front().index, 101);
+    EXPECT_EQ(stats.by_time.sorted().front().index, 101);
+}
+
+#ifdef SUDOKU_SOLVER_EXE
+TEST(Shard_CoordinatorRetriesFailedWorker) {
+    /*
+    Real worker processes, through a shell wrapper that makes the first
+    run of the shard starting at byte 0 fail once
+    */
+    const std::string path = write_input("sudoku_shard_run.txt");
+    const std::string marker = temp_path("sudoku_shard_run.failed");
+    std::filesystem::remove(marker);
+
+    CoordinatorConfig cc;
+    cc.workers = 2;
+    cc.backup_after = 1e9; // no backups, so the launch count is exact
+    cc.worker_argv = { "/bin/sh", "-c",
+        "if [ \"$6\" = 0 ] && [ ! -e " + marker + " ]; then touch " + marker + "; exit 3; fi; exec \"$@\"",
+        "sh", SUDOKU_SOLVER_EXE, "--shard-format", "csv" };
+
+    const auto shards = split_shards(path, 3);
+    std::vector<std::size_t> order;
+    std::string records;
+    unsigned solved = 0;
+    const CoordinatorReport report = run_shards(shards, cc, [&](std::size_t k, ShardResult& r) {
+        order.push_back(k);
+        records += r.records;
+        solved += r.stats.solved;
+    });
+
+    EXPECT_EQ(report.failed, 1u);
+    EXPECT_EQ(report.launched, static_cast<unsigned>(shards.size()) + 1);
+    EXPECT_TRUE(report.lost_shards.empty());
+    EXPECT_EQ(order.size(), shards.size());
+    for (std::size_t k = 0; k < order.size(); ++k) EXPECT_EQ(order[k], k);
+    EXPECT_EQ(solved, static_cast<unsigned>(grids.size()));
+
+    // every puzzle's record, in input order
+    std::size_t at = 0;
+    for (const auto& g : grids) {
+        const auto pos = records.find(g, at);
+        EXPECT_TRUE((pos != std::string::npos));
+        at = pos == std::string::npos ? at : pos;
+    }
+
+    std::filesystem::remove(marker);
+    std::filesystem::remove(path);
+}
+
+TEST(Shard_CoordinatorKeepsBackupOfFailedShard) {
+    /*
+    The first run of the shard at byte 0 fails after a second. By then the
+    other shard is done and a backup copy is running, sleeping two seconds
+    before it solves; the failure must leave the shard to the backup
+    */
+    const std::string path = write_input("sudoku_shard_backup.txt");
+    const std::string marker = temp_path("sudoku_shard_backup.failed");
+    std::filesystem::remove(marker);
+
+    CoordinatorConfig cc;
+    cc.workers = 2;
+    cc.backup_after = 0.0;
+    cc.max_attempts = 1;
+    cc.worker_argv = { "/bin/sh", "-c",
+        "if [ \"$6\" = 0 ]; then if [ ! -e " + marker + " ]; then touch " + marker + "; sleep 1; exit 3; fi; sleep 2; fi; exec \"$@\"",
+        "sh", SUDOKU_SOLVER_EXE, "--shard-format", "none" };
+
+    const auto shards = split_shards(path, 2);
+    std::vector<std::size_t> order;
+    unsigned solved = 0;
+    const CoordinatorReport report = run_shards(shards, cc, [&](std::size_t k, ShardResult& r) {
+        order.push_back(k);
+        solved += r.stats.solved;
+    });
+
+    EXPECT_EQ(report.failed, 1u);
+    EXPECT_EQ(report.backups, 1u);
+    EXPECT_EQ(report.launched, 3u);
+    EXPECT_TRUE(report.lost_shards.empty());
+    EXPECT_EQ(order.size(), shards.size());
+    EXPECT_EQ(solved, static_cast<unsigned>(grids.size()));
+
+    std::filesystem::remove(marker);
+    std::filesystem::remove(path);
+}
+
+TEST(Shard_CoordinatorGivesUpOnBrokenWorker) {
+    const std::string path = write_input("sudoku_shard_broken.txt");
+    CoordinatorConfig cc;
+    cc.worker_argv = { "/bin/sh", "-c", "echo sudoku-shard 1; exit 0", "sh" };
+    cc.max_attempts = 2;
+
+    const auto shards = split_shards(path, 2);
+    unsigned delivered = 0;
+    const CoordinatorReport report = run_shards(shards, cc, [&](std::size_t, ShardResult&) { ++delivered; });
+
+    EXPECT_EQ(delivered, 0u);
+    EXPECT_EQ(report.failed, 2u * shards.size());
+    EXPECT_EQ(report.lost_shards.size(), shards.size());
+    std::filesystem::remove(path);
+}
+#endif
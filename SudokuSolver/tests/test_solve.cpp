@@ -1,6 +1,11 @@
 #include "test_macros.h"
+#include "solution_checks.h"
 #include <iostream>
+#include "../ParallelSearch.h"
 #include "../Puzzle.h"
+#include "../bit_ops.h"
+#include <algorithm>
+#include <random>
 #include <vector>
 
 TEST(Puzzle_SolveHardest) {
@@ -18,7 +23,7 @@ TEST(Puzzle_SolveHardest) {
     } };
 
     for (auto& ps : puzzles) {
-        Puzzle p(ps, true);
+        Puzzle p(ps);
         p.solve();
         EXPECT_TRUE(p.solved());
     }
@@ -39,8 +44,130 @@ TEST(Puzzle_SolveHardestRecurse) {
     } };
 
     for (auto& ps : puzzles) {
-        Puzzle p(ps, true);
+        Puzzle p(ps);
         p.solve_recurse();
         EXPECT_TRUE(p.solved());
     }
-}
\ No newline at end of file
+}
+
+template<unsigned B>
+std::string make_pattern_puzzle(unsigned seed, unsigned keep_percent) {
+    // a valid filled board with shuffled values and random cells cleared
+    constexpr unsigned N = B * B;
+    std::mt19937 rng(seed);
+
+    std::vector<unsigned> values(N);
+    for (unsigned v = 0; v < N; ++v) values[v] = v;
+    std::shuffle(values.begin(), values.end(), rng);
+
+    std::string s(N * N, '.');
+    for (unsigned r = 0; r < N; ++r) {
+        for (unsigned c = 0; c < N; ++c) {
+            if (rng() % 100 < keep_percent) {
+                s[N * r + c] = value_symbols[values[(B * (r % B) + r / B + c) % N]];
+            }
+        }
+    }
+    return s;
+}
+
+TEST(Puzzle_SolveOtherSizes) {
+    BasicPuzzle<2> p4("1.....3..2.....4");
+    p4.solve();
+    EXPECT_TRUE(p4.solved());
+    EXPECT_TRUE(is_valid_solution("1.....3..2.....4", p4.solution()));
+
+    for (unsigned seed = 0; seed < 3; ++seed) {
+        const std::string s16 = make_pattern_puzzle<4>(seed, 45);
+        BasicPuzzle<4> p16(s16);
+        p16.solve();
+        EXPECT_TRUE(p16.solved());
+        EXPECT_TRUE(is_valid_solution(s16, p16.solution()));
+
+        BasicPuzzle<4> r16(s16);
+        r16.solve_recurse();
+        EXPECT_TRUE(r16.solved());
+        EXPECT_TRUE(is_valid_solution(s16, r16.solution()));
+
+        const std::string s25 = make_pattern_puzzle<5>(seed, 55);
+        BasicPuzzle<5> p25(s25);
+        p25.solve();
+        EXPECT_TRUE(p25.solved());
+        EXPECT_TRUE(is_valid_solution(s25, p25.solution()));
+    }
+}
+
+TEST(Puzzle_InvalidSize) {
+    EXPECT_ANY_THROW(Puzzle("123"));
+    EXPECT_ANY_THROW(BasicPuzzle<4>(std::string(81, '.')));
+}
+
+TEST(Puzzle_SolveParallel) {
+    const std::vector<std::string> puzzles = {
+        "..39.....4...8..36..8...1...4..6..738......1......2.....4.7..686........7.....5..",
+        "1....6.8....7..1....9.....4.......5..18..5...5..36.8..6.5..8.3.8....3.1.....2....",
+        "....9..5..1.....3...23..7....45...7.8.....2.......64...9..1.....8..6......54....7"
+    };
+
+    for (auto& grid : puzzles) {
+        const auto expected = sudoku::solve(grid);
+        for (unsigned threads : { 2u, 4u }) {
+            const auto r = solve_parallel<3>(grid, sudoku::Options(), threads, 3);
+            EXPECT_TRUE((r.status == sudoku::Status::Solved));
+            EXPECT_TRUE((r.solution == expected.solution));
+            EXPECT_TRUE((r.stats.guesses > 0));
+        }
+    }
+
+    // no solution, and a split that runs out of tasks before any solver does
+    const std::string bad = "11" + std::string(79, '.');
+    EXPECT_TRUE((solve_parallel<3>(bad, sudoku::Options(), 4).status == sudoku::Status::NoSolution));
+    EXPECT_TRUE((solve_parallel<2>("1.....3..2.....4", sudoku::Options(), 3).status == sudoku::Status::Solved));
+
+    sudoku::Options opts;
+    opts.threads = 3;
+    EXPECT_TRUE((sudoku::solve(puzzles[0], opts).status == sudoku::Status::Solved));
+}
+
+TEST(Puzzle_TrailUndo) {
+    const std::vector<std::string> puzzles = {
+        "..39.....4...8..36..8...1...4..6..738......1......2.....4.7..686........7.....5..",
+        "1....6.8....7..1....9.....4.......5..18..5...5..36.8..6.5..8.3.8....3.1.....2....",
+        "11" + std::string(79, '.')
+    };
+
+    for (auto& grid : puzzles) {
+        Puzzle snapshot(grid);
+        snapshot.solve();
+
+        Puzzle trail(grid);
+        trail.set_undo_mode(sudoku::Undo::Trail);
+        trail.solve();
+
+        // the same search, just a different way of taking guesses back
+        EXPECT_TRUE((trail.status() == snapshot.status()));
+        EXPECT_TRUE((trail.solution() == snapshot.solution()));
+        EXPECT_EQ(snapshot.num_guesses(), trail.num_guesses());
+        if (snapshot.num_guesses() > 0) {
+            EXPECT_TRUE((trail.stats().undo_bytes < snapshot.stats().undo_bytes));
+        }
+    }
+}
+
+TEST(Puzzle_GuessOnEmptyCell) {
+    // a state handed in with a cell that has no options left and nothing for the rules to do
+    const std::string blank(81, '.');
+    Puzzle::Entries state;
+    state.fill(base_mask_v<3>);
+    state[40] = 0;
+
+    for (auto b : { sudoku::Branching::Mrv, sudoku::Branching::Degree, sudoku::Branching::Frequency, sudoku::Branching::UnitDigit }) {
+        for (auto u : { sudoku::Undo::Snapshot, sudoku::Undo::Trail }) {
+            Puzzle p(blank, state);
+            p.set_branching(b);
+            p.set_undo_mode(u);
+            p.solve();
+            EXPECT_TRUE((p.status() == sudoku::Status::NoSolution));
+        }
+    }
+}
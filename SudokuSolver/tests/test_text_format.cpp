@@ -0,0 +1,119 @@
+#include "test_macros.h"
+#include "../TextFormat.h"
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+namespace {
+
+// the boxed grid as operator<< used to print it, one insertion at a time
+template<unsigned B>
+std::string reference_grid(const typename BasicPuzzle<B>::Entries& entries) {
+    constexpr unsigned N = B * B;
+    std::ostringstream p;
+
+    std::string thick = "++";
+    std::string thin = "++";
+    for (unsigned b = 0; b < B; ++b) {
+        thin += "\033[90m";
+        for (unsigned c = 0; c < B; ++c) {
+            thick += std::string(2 * B + 1, '=') + (c + 1 < B ? "+" : "++");
+            thin += std::string(2 * B + 1, '-') + (c + 1 < B ? "+" : "");
+        }
+        thin += "\033[0m++";
+    }
+    thick += "\n";
+    thin += "\n";
+
+    p << thick;
+    for (unsigned i = 0; i < N; ++i) {
+        for (unsigned sr = 0; sr < B; ++sr) {
+            p << "||";
+            for (unsigned j = 0; j < N; ++j) {
+                const auto e = entries[N * i + j];
+                const bool has_val = has_single_value<B>(e);
+                const unsigned val = lowest_bit<B>(e);
+                for (unsigned sc = 0; sc < B; ++sc) {
+                    const unsigned opt = B * sr + sc + 1;
+                    if (has_val) {
+                        if (sc == B / 2 && sr == B / 2) p << " " << "\033[91m" << value_symbols[val - 1] << "\033[0m";
+                        else p << "  ";
+                    }
+                    else if (has_bit<B>(e, opt)) {
+                        p << " " << "\033[90m" << value_symbols[opt - 1] << "\033[0m";
+                    }
+                    else {
+                        p << "  ";
+                    }
+                }
+                if ((j + 1) % B == 0) p << " ||";
+                else p << "\033[90m" << " |" << "\033[0m";
+            }
+            p << "\n";
+        }
+        p << ((i + 1) % B == 0 ? thick : thin);
+    }
+    return p.str();
+}
+
+template<unsigned B>
+bool check_grid(const std::string& grid) {
+    BasicPuzzle<B> p(grid);
+    p.propagate();
+
+    std::ostringstream printed;
+    printed << p;
+    const std::string expected = reference_grid<B>(p.state());
+
+    std::string s(B * B * B * B, '?');
+    format_solution<B>(p.state().data(), &s[0]);
+    return printed.str() == expected && expected.size() <= grid_text_max<B>() && s == p.solution();
+}
+
+}
+
+TEST(TextFormat_Grids) {
+    EXPECT_TRUE(check_grid<2>("1.....3..2.....4"));
+    EXPECT_TRUE(check_grid<3>("1.......2..34...5..6....7.....85..9....3.6.....8.9.....2....1..7.......6..9.8..3."));
+    EXPECT_TRUE(check_grid<3>("812753649943682175675491283154237896369845721287169534521974368438526917796318452"));
+    EXPECT_TRUE(check_grid<4>(std::string(256, '.')));
+
+    EXPECT_EQ('.', symbol_table_v<3>[0]);
+    EXPECT_EQ('.', symbol_table_v<3>[3]);
+    EXPECT_EQ('9', symbol_table_v<3>[256]);
+    EXPECT_EQ('G', entry_symbol<4>(entry_t<4>(1u << 15)));
+}
+
+TEST(TextFormat_Numbers) {
+    for (double ms : { 0.0, 0.0004, 0.0005, 0.1234, 1.5, 12.3456, 999.9995, 123456.789 }) {
+        char expected[64];
+        std::snprintf(expected, sizeof(expected), "%.3f", ms);
+        char buf[32];
+        EXPECT_TRUE((std::string(buf, format_ms(buf, ms)) == expected));
+    }
+    char buf[32];
+    EXPECT_TRUE((std::string(buf, format_uint(buf, 0)) == "0"));
+    EXPECT_TRUE((std::string(buf, format_uint(buf, 18446744073709551615ull)) == "18446744073709551615"));
+    EXPECT_TRUE((std::string(buf, format_ms(buf, 1e40)) == "1.000e+40"));
+}
+
+TEST(TextFormat_OutputBuffer) {
+    std::ostringstream os;
+    std::string expected;
+    {
+        OutputBuffer out(os, 16);
+        for (int i = 0; i < 100; ++i) {
+            out << "line " << std::to_string(i) << '\n';
+            expected += "line " + std::to_string(i) + "\n";
+        }
+        // longer than the whole buffer
+        const std::string big(40, 'x');
+        out << big;
+        expected += big;
+
+        char* p = out.reserve(20);
+        out.commit(format_uint(p, 12345));
+        expected += "12345";
+    }
+    EXPECT_TRUE((os.str() == expected));
+}
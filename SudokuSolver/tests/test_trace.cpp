@@ -0,0 +1,50 @@
+#include "test_macros.h"
+#include "../Trace.h"
+#include "../sudoku.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+TEST(Trace_ChromeJson) {
+    const std::string grid = "1....6.8....7..1....9.....4.......5..18..5...5..36.8..6.5..8.3.8....3.1.....2....";
+    const std::string path = (std::filesystem::temp_directory_path() / "sudoku_trace_test.json").string();
+
+    // nothing is recorded until tracing is switched on
+    const auto before = trace::recorded_events();
+    sudoku::solve(grid);
+    EXPECT_EQ(before, trace::recorded_events());
+
+    trace::enable(true);
+    std::thread t([&] {
+        trace::set_thread_name("test \"worker\"");
+        sudoku::solve(grid);
+    });
+    t.join();
+    sudoku::solve(grid);
+    trace::enable(false);
+
+    if (!trace::compiled_in) {
+        EXPECT_FALSE(trace::enabled());
+        EXPECT_EQ(0u, trace::recorded_events());
+        EXPECT_FALSE(trace::write_chrome_json(path));
+        return;
+    }
+
+    EXPECT_TRUE((trace::recorded_events() > before));
+    EXPECT_TRUE(trace::write_chrome_json(path));
+
+    std::ifstream in(path);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    const std::string json = ss.str();
+    std::filesystem::remove(path);
+
+    EXPECT_TRUE((json.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0) == 0));
+    EXPECT_TRUE((json.find("]}") != std::string::npos));
+    for (const char* span : { "\"parse\"", "\"solve\"", "\"rule1\"", "\"rule2\"", "\"guess\"", "\"revert\"" }) {
+        EXPECT_TRUE((json.find(span) != std::string::npos));
+    }
+    EXPECT_TRUE((json.find("\"test \\\"worker\\\"\"") != std::string::npos));
+}
@@ -0,0 +1,46 @@
+#include "test_macros.h"
+#include "../unit_tables.h"
+#include <algorithm>
+
+TEST(UnitTables_Sets) {
+    constexpr auto sets = make_sets();
+    constexpr auto entity_sets = make_entity_sets();
+
+    // every cell appears in exactly the three sets listed for it
+    for (unsigned i = 0; i < 81; ++i) {
+        unsigned count = 0;
+        for (unsigned k = 0; k < 27; ++k) {
+            const bool in_set = std::find(sets[k].begin(), sets[k].end(), i) != sets[k].end();
+            const bool listed = std::find(entity_sets[i].begin(), entity_sets[i].end(), k) != entity_sets[i].end();
+            EXPECT_TRUE((in_set == listed));
+            if (in_set) ++count;
+        }
+        EXPECT_EQ(3u, count);
+    }
+
+    EXPECT_EQ(63u, sets[24][3]);
+    EXPECT_EQ(80u, sets[26][8]);
+}
+
+TEST(UnitTables_Peers) {
+    constexpr auto peers = make_peers();
+    constexpr auto unit_masks = make_unit_masks();
+
+    for (unsigned i = 0; i < 81; ++i) {
+        CellMask<> seen;
+        for (auto ei : peers[i]) {
+            EXPECT_FALSE((ei == i));
+            EXPECT_FALSE(seen.test(ei));
+            seen.set(ei);
+
+            const bool shares_unit = cell_row(ei) == cell_row(i) || cell_col(ei) == cell_col(i) || cell_box(ei) == cell_box(i);
+            EXPECT_TRUE(shares_unit);
+        }
+        EXPECT_TRUE(unit_masks[18 + cell_box(i)].test(i));
+    }
+
+    // top left cell peers: 8 in the row, 8 in the column, 4 more in the box
+    EXPECT_EQ(1u, peers[0][0]);
+    EXPECT_EQ(9u, peers[0][8]);
+    EXPECT_EQ(72u, peers[0][19]);
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+/*
+Compile-time generated lookup tables describing the units (rows, columns
+and boxes) of a board and the peers of each cell. Everything here is
+built by constexpr functions so the tables live in read-only data and the
+solver loops over them without any index arithmetic.
+
+All tables are templated on the box size B (3 for a standard 9x9 board,
+2 for 4x4, 4 for 16x16, 5 for 25x25) and default to the 9x9 board.
+
+Unit numbering for an N x N board (N = B*B): 0..N-1 are rows, N..2N-1 are
+columns, 2N..3N-1 are boxes.
+*/
+
+template<unsigned B = 3>
+struct Geometry {
+    static constexpr unsigned N = B * B;                // digits, and cells per unit
+    static constexpr unsigned cells = N * N;
+    static constexpr unsigned units = 3 * N;
+    static constexpr unsigned peers = 3 * N - 2 * B - 1; // distinct cells sharing a unit
+};
+
+// A set of cells on the board, one bit per cell
+template<unsigned B = 3>
+struct CellMask {
+    std::array<std::uint64_t, (Geometry<B>::cells + 63) / 64> words{};
+
+    constexpr void set(unsigned cell) {
+        words[cell / 64] |= (std::uint64_t(1) << (cell % 64));
+    }
+
+    constexpr bool test(unsigned cell) const {
+        return (words[cell / 64] >> (cell % 64)) & 1;
+    }
+
+    constexpr bool contains(const CellMask& other) const {
+        for (unsigned w = 0; w < words.size(); ++w) {
+            if ((words[w] & other.words[w]) != other.words[w]) return false;
+        }
+        return true;
+    }
+};
+
+template<unsigned B = 3>
+constexpr unsigned cell_row(unsigned i) { return i / (B * B); }
+
+template<unsigned B = 3>
+constexpr unsigned cell_col(unsigned i) { return i % (B * B); }
+
+template<unsigned B = 3>
+constexpr unsigned cell_box(unsigned i) { return B * (i / (B * B * B)) + (i % (B * B)) / B; }
+
+template<unsigned B = 3>
+using UnitSets = std::array<std::array<unsigned, Geometry<B>::N>, Geometry<B>::units>;
+
+//===============================================================================
+template<unsigned B = 3>
+constexpr UnitSets<B> make_sets() {
+    constexpr unsigned N = Geometry<B>::N;
+    UnitSets<B> s{};
+    for (unsigned k = 0; k < N; ++k) {
+        for (unsigned m = 0; m < N; ++m) {
+            s[k][m] = N * k + m;                                               // row k
+            s[N + k][m] = N * m + k;                                           // column k
+            s[2 * N + k][m] = B * N * (k / B) + B * (k % B) + N * (m / B) + m % B; // box k
+        }
+    }
+    return s;
+}
+
+//===============================================================================
+template<unsigned B = 3>
+constexpr std::array<std::array<unsigned, 3>, Geometry<B>::cells> make_entity_sets() {
+    constexpr unsigned N = Geometry<B>::N;
+    std::array<std::array<unsigned, 3>, Geometry<B>::cells> es{};
+    for (unsigned i = 0; i < Geometry<B>::cells; ++i) {
+        es[i] = { cell_row<B>(i), N + cell_col<B>(i), 2 * N + cell_box<B>(i) };
+    }
+    return es;
+}
+
+//===============================================================================
+template<unsigned B = 3>
+constexpr std::array<std::array<unsigned, Geometry<B>::peers>, Geometry<B>::cells> make_peers() {
+    std::array<std::array<unsigned, Geometry<B>::peers>, Geometry<B>::cells> p{};
+    for (unsigned i = 0; i < Geometry<B>::cells; ++i) {
+        unsigned n = 0;
+        for (unsigned j = 0; j < Geometry<B>::cells; ++j) {
+            if (j == i) continue;
+            if (cell_row<B>(j) == cell_row<B>(i) || cell_col<B>(j) == cell_col<B>(i) || cell_box<B>(j) == cell_box<B>(i)) {
+                p[i][n++] = j;
+            }
+        }
+    }
+    return p;
+}
+
+//===============================================================================
+template<unsigned B = 3>
+constexpr std::array<CellMask<B>, Geometry<B>::units> make_unit_masks() {
+    constexpr auto s = make_sets<B>();
+    std::array<CellMask<B>, Geometry<B>::units> m{};
+    for (unsigned k = 0; k < Geometry<B>::units; ++k) {
+        for (auto ei : s[k]) m[k].set(ei);
+    }
+    return m;
+}